@@ -0,0 +1,118 @@
+#include "archetype.h"
+
+#include <cstring>
+
+namespace gear2d {
+  archetype::archetype(const std::string & ids) {
+    std::vector<std::string> names;
+    split(names, ids, ' ');
+    for (size_t i = 0; i < names.size(); i++) {
+      if (names[i].empty()) continue;
+      column c;
+      c.pid = names[i];
+      c.type = 0;
+      c.size = 0;
+      columns.push_back(c);
+    }
+  }
+
+  archetype::~archetype() {
+    for (size_t i = 0; i < columns.size(); i++) {
+      for (size_t b = 0; b < columns[i].blocks.size(); b++) delete [] columns[i].blocks[b];
+    }
+  }
+
+  archetype::column * archetype::find(const symbol & pid) {
+    for (size_t i = 0; i < columns.size(); i++) {
+      if (columns[i].pid == pid) return &columns[i];
+    }
+    return 0;
+  }
+
+  bool archetype::has(const symbol & pid) const {
+    for (size_t i = 0; i < columns.size(); i++) {
+      if (columns[i].pid == pid) return true;
+    }
+    return false;
+  }
+
+  int archetype::row() {
+    std::lock_guard<std::mutex> guard(lock);
+    int r;
+    if (!unused.empty()) {
+      r = unused.back();
+      unused.pop_back();
+    } else {
+      r = live.size();
+      live.push_back(0);
+    }
+    live[r] = 1;
+    return r;
+  }
+
+  void archetype::release(int r) {
+    std::lock_guard<std::mutex> guard(lock);
+    if (r < 0 || r >= (int)live.size() || !live[r]) return;
+    live[r] = 0;
+    unused.push_back(r);
+  }
+
+  void archetype::pool(int r, bool pooled) {
+    std::lock_guard<std::mutex> guard(lock);
+    if (r < 0 || r >= (int)live.size() || !live[r]) return;
+    live[r] = pooled ? 2 : 1;
+  }
+
+  bool archetype::alive(int r) {
+    std::lock_guard<std::mutex> guard(lock);
+    return r >= 0 && r < (int)live.size() && live[r] == 1;
+  }
+
+  void archetype::copy(int from, int to) {
+    if (from < 0 || to < 0 || from == to) return;
+    std::lock_guard<std::mutex> guard(lock);
+    size_t fb = from / blocksize, tb = to / blocksize;
+    for (size_t i = 0; i < columns.size(); i++) {
+      column & c = columns[i];
+      if (c.type == 0 || fb >= c.blocks.size() || tb >= c.blocks.size()) continue;
+      std::memcpy(c.blocks[tb] + (to % blocksize) * c.size, c.blocks[fb] + (from % blocksize) * c.size, c.size);
+    }
+  }
+
+  size_t archetype::rows() {
+    std::lock_guard<std::mutex> guard(lock);
+    return live.size();
+  }
+
+  size_t archetype::blocks() {
+    std::lock_guard<std::mutex> guard(lock);
+    return (live.size() + blocksize - 1) / blocksize;
+  }
+
+  void * archetype::cell(const symbol & pid, int r, const std::type_info & type, size_t size) {
+    if (r < 0) return 0;
+    std::lock_guard<std::mutex> guard(lock);
+    column * c = find(pid);
+    if (c == 0) return 0;
+    if (c->type == 0) {
+      c->type = &type;
+      c->size = size;
+    } else if (*(c->type) != type) return 0;
+
+    /* blocks are zeroed, numbers start at 0 */
+    size_t b = r / blocksize;
+    while (c->blocks.size() <= b) {
+      char * block = new char[blocksize * c->size];
+      std::memset(block, 0, blocksize * c->size);
+      c->blocks.push_back(block);
+    }
+    return c->blocks[b] + (r % blocksize) * c->size;
+  }
+
+  void * archetype::chunk(const symbol & pid, size_t b, const std::type_info & type) {
+    std::lock_guard<std::mutex> guard(lock);
+    column * c = find(pid);
+    if (c == 0 || c->type == 0 || *(c->type) != type || b >= c->blocks.size()) return 0;
+    return c->blocks[b];
+  }
+}
@@ -0,0 +1,128 @@
+#ifndef gear2d_archetype_h
+#define gear2d_archetype_h
+
+#include "definitions.h"
+#include "symbol.h"
+
+#include <vector>
+#include <mutex>
+#include <typeinfo>
+#include <type_traits>
+
+/**
+ * @file archetype.h
+ * @brief Column storage for numeric parameters of an object type.
+ *
+ * Objects of a type that lists @p columns: get a row in the storage of
+ * that type, and the listed numeric parameters are kept in one array per
+ * parameter, indexed by that row, instead of one allocation per value. */
+
+namespace gear2d {
+  /**
+   * @brief Struct-of-arrays storage shared by the objects of a type.
+   *
+   * Columns are split in blocks of blocksize rows. Blocks never move,
+   * so parameters can keep pointing inside them, and code going over
+   * every object of the type can stream a block of each column at once:
+   *
+   * @code
+   * archetype * bullets = columns("bullet");
+   * for (size_t b = 0; bullets != 0 && b < bullets->blocks(); b++) {
+   *   float * x = bullets->block<float>("x", b);
+   *   float * vx = bullets->block<float>("vx", b);
+   *   if (x == 0 || vx == 0) continue;
+   *   for (size_t i = 0; i < archetype::blocksize; i++) x[i] += vx[i] * dt;
+   * }
+   * @endcode
+   *
+   * Rows of dead objects are reused by the next ones, and rows of pooled
+   * objects are kept for them; either way their values are left as they
+   * were, use alive() to tell them apart. Writing to a
+   * column directly does not notify whoever hooked the parameter. */
+  class g2dapi archetype {
+    public:
+      /** @brief Rows per block. */
+      static const size_t blocksize = 256;
+
+    public:
+      /**
+       * @brief Builds the storage of a type.
+       * @param columns Space-separated list of parameter ids to keep in columns */
+      archetype(const std::string & columns);
+      ~archetype();
+
+      /** @brief Whether a parameter id is kept in a column. */
+      bool has(const symbol & pid) const;
+
+      /** @brief Takes a row for a new object. */
+      int row();
+
+      /** @brief Gives a row back. */
+      void release(int row);
+
+      /**
+       * @brief Keeps a row, but not alive, while its object waits in a pool.
+       * @param row Row of the object
+       * @param pooled Whether it goes to the pool or comes back from it */
+      void pool(int row, bool pooled);
+
+      /** @brief Whether a row belongs to a living, not pooled, object. */
+      bool alive(int row);
+
+      /**
+       * @brief Copies every column of a row into another.
+       * @param from Row copied
+       * @param to Row overwritten */
+      void copy(int from, int to);
+
+      /** @brief Rows ever taken: every row is below this. */
+      size_t rows();
+
+      /** @brief Number of blocks to go through to see every row. */
+      size_t blocks();
+
+      /**
+       * @brief Value of a parameter at a row.
+       * @return Where the value lives, or null if the parameter is not kept
+       * in a column, or is kept with another type
+       *
+       * The first call for a parameter decides the type of its column. Only
+       * arithmetic types are kept in columns. */
+      template<typename datatype>
+      datatype * at(const symbol & pid, int row) {
+        if (!std::is_arithmetic<datatype>::value) return 0;
+        return (datatype *) cell(pid, row, typeid(datatype), sizeof(datatype));
+      }
+
+      /**
+       * @brief A block of a column.
+       * @return blocksize values, or null if there is no such column, block or type */
+      template<typename datatype>
+      datatype * block(const symbol & pid, size_t b) {
+        return (datatype *) chunk(pid, b, typeid(datatype));
+      }
+
+    private:
+      struct column {
+        symbol pid;
+
+        /* decided by the first access, null until then */
+        const std::type_info * type;
+        size_t size;
+        std::vector<char *> blocks;
+      };
+
+      column * find(const symbol & pid);
+      void * cell(const symbol & pid, int row, const std::type_info & type, size_t size);
+      void * chunk(const symbol & pid, size_t b, const std::type_info & type);
+
+    private:
+      std::vector<column> columns;
+      /* 0 free, 1 alive, 2 pooled */
+      std::vector<char> live;
+      std::vector<int> unused;
+      std::mutex lock;
+  };
+}
+
+#endif
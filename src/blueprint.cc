@@ -0,0 +1,34 @@
+#include "blueprint.h"
+
+namespace gear2d {
+  blueprint::blueprint()
+  : compiled(false) {
+  }
+
+  blueprint::~blueprint() {
+    for (std::unordered_map<symbol, std::vector<entry> >::iterator i = values.begin(); i != values.end(); i++) {
+      for (size_t t = 0; t < i->second.size(); t++) delete i->second[t].value;
+    }
+  }
+
+  bool blueprint::ready() const {
+    return compiled;
+  }
+
+  void blueprint::add(builder b) {
+    parts.push_back(b);
+  }
+
+  void blueprint::finish(bool complete) {
+    compiled = complete;
+    if (!complete) parts.clear();
+  }
+
+  size_t blueprint::size() const {
+    return parts.size();
+  }
+
+  blueprint::builder blueprint::part(size_t i) const {
+    return parts[i];
+  }
+}
@@ -0,0 +1,153 @@
+#ifndef gear2d_blueprint_h
+#define gear2d_blueprint_h
+
+#include "definitions.h"
+#include "parameter.h"
+#include "symbol.h"
+
+#include <vector>
+#include <unordered_map>
+#include <typeinfo>
+#include <type_traits>
+
+/**
+ * @file blueprint.h
+ * @brief What it takes to build an object of a type, worked out once.
+ *
+ * The first object of a type is built the long way: its attach list
+ * is parsed, dependencies are looked for and loaded, and its components
+ * evaluate their values out of the signature. The blueprint remembers
+ * the outcome so the next objects of the type skip all of that. */
+
+namespace gear2d {
+  namespace component { class base; }
+
+  /**
+   * @brief Compiled build of an object type.
+   *
+   * Holds the builders of the components of the type, in the order they
+   * were attached, and the values of the signature already evaluated to
+   * the types the components asked for. */
+  class g2dapi blueprint {
+    public:
+      /** @brief Builder of a component, as registered in the component factory. */
+      typedef component::base * (*builder)();
+
+    public:
+      blueprint();
+      ~blueprint();
+
+      /** @brief Whether the attach order is known. */
+      bool ready() const;
+
+      /**
+       * @brief Adds the next component to attach.
+       * @param b Its builder */
+      void add(builder b);
+
+      /**
+       * @brief Marks the attach order as complete.
+       * @param complete Whether every component of the type was found.
+       * If not, the blueprint is left unready and objects keep being built
+       * the long way. */
+      void finish(bool complete);
+
+      /** @brief Number of components to attach. */
+      size_t size() const;
+
+      /** @brief Builder of the i-th component to attach. */
+      builder part(size_t i) const;
+
+      /**
+       * @brief Value of the signature evaluated to a type.
+       * @param pid Parameter id
+       * @param raw Its string in the signature
+       * @param def Default if @p raw can't be evaluated
+       * @return The value, evaluated only the first time it is asked for
+       * with the same type and string, or @p def
+       *
+       * Numbers, bools and strings are kept once evaluated, per id and
+       * type. Strings that fail to evaluate are not kept, so every caller
+       * gets its own default. Other types are evaluated every time, with
+       * whatever eval() does for them. */
+      template<typename datatype>
+      datatype value(const symbol & pid, const std::string & raw, const datatype & def) {
+        typedef std::integral_constant<bool, std::is_arithmetic<datatype>::value || std::is_same<datatype, std::string>::value> kept;
+        return value(pid, raw, def, kept());
+      }
+
+    private:
+      template<typename datatype>
+      datatype value(const symbol & pid, const std::string & raw, const datatype & def, std::false_type) {
+        return eval<datatype>(raw, def);
+      }
+
+      template<typename datatype>
+      datatype value(const symbol & pid, const std::string & raw, const datatype & def, std::true_type) {
+        std::vector<entry> & types = values[pid];
+        entry * e = 0;
+        for (size_t i = 0; i < types.size() && e == 0; i++) if (*(types[i].type) == typeid(datatype)) e = &types[i];
+        if (e == 0) {
+          types.push_back(entry());
+          e = &types.back();
+          e->type = &typeid(datatype);
+        }
+
+        if (e->value == 0 || e->raw != raw) {
+          delete e->value;
+          e->value = 0;
+          e->raw = raw;
+          datatype v;
+          if (!evaluate(raw, v)) return def;
+          e->value = new held<datatype>(v);
+        }
+        return static_cast<held<datatype> *>(e->value)->v;
+      }
+
+      /* like eval(), but telling whether raw held a value */
+      template<typename datatype>
+      static bool evaluate(const std::string & raw, datatype & v) {
+        return parser<datatype>::parse(raw, v);
+      }
+
+      static bool evaluate(const std::string & raw, std::string & v) {
+        if (raw.empty()) return false;
+        v = raw;
+        return true;
+      }
+
+      static bool evaluate(const std::string & raw, bool & v) {
+        if (raw.empty()) return false;
+        v = eval<bool>(raw, false);
+        return true;
+      }
+
+    private:
+      /* an evaluated value of any type */
+      struct box {
+        virtual ~box() { }
+      };
+
+      template<typename datatype>
+      struct held : box {
+        held(const datatype & v) : v(v) { }
+        datatype v;
+      };
+
+      /* one per type asked for under an id. a failed evaluation leaves no value */
+      struct entry {
+        entry() : type(0), value(0) { }
+
+        std::string raw;
+        const std::type_info * type;
+        box * value;
+      };
+
+    private:
+      std::vector<builder> parts;
+      bool compiled;
+      std::unordered_map<symbol, std::vector<entry> > values;
+  };
+}
+
+#endif
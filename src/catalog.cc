@@ -0,0 +1,239 @@
+#include "catalog.h"
+#include "threadpool.h"
+#include "definitions.h"
+
+#include <fstream>
+#include <sstream>
+#include <set>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+# include <windows.h>
+#else
+# include <dirent.h>
+#endif
+
+#if defined(__linux__) || defined(__FreeBSD__)
+# include <elf.h>
+# define G2D_ELF
+#endif
+
+namespace gear2d {
+  namespace {
+    /* names in a directory, either its subdirectories or its files */
+    void list(const std::string & dir, bool directories, std::vector<std::string> & names) {
+#ifdef _WIN32
+      WIN32_FIND_DATAA data;
+      HANDLE h = FindFirstFileA((dir + "\\*").c_str(), &data);
+      if (h == INVALID_HANDLE_VALUE) return;
+      do {
+        std::string name = data.cFileName;
+        if (name == "." || name == "..") continue;
+        bool isdir = (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+        if (isdir == directories) names.push_back(name);
+      } while (FindNextFileA(h, &data));
+      FindClose(h);
+#else
+      DIR * d = opendir(dir.c_str());
+      if (d == 0) return;
+      while (dirent * e = readdir(d)) {
+        std::string name = e->d_name;
+        if (name == "." || name == "..") continue;
+        struct stat st;
+        if (stat((dir + "/" + name).c_str(), &st) != 0) continue;
+        if (S_ISDIR(st.st_mode) == directories) names.push_back(name);
+      }
+      closedir(d);
+#endif
+    }
+
+    /* libraries of a family directory */
+    void walk(const std::string & dir, const std::string & family, const std::string & prefix, const std::string & suffix, std::vector<catalog::entry> & out) {
+      std::vector<std::string> files;
+      list(dir, false, files);
+      for (size_t i = 0; i < files.size(); i++) {
+        const std::string & name = files[i];
+        if (name.size() <= prefix.size() + suffix.size()) continue;
+        if (name.compare(0, prefix.size(), prefix) != 0) continue;
+        if (name.compare(name.size() - suffix.size(), suffix.size(), suffix) != 0) continue;
+
+        catalog::entry e;
+        e.family = family;
+        e.type = name.substr(prefix.size(), name.size() - prefix.size() - suffix.size());
+        e.file = dir + "/" + name;
+        struct stat st;
+        if (stat(e.file.c_str(), &st) != 0) continue;
+        e.mtime = st.st_mtime;
+        e.size = st.st_size;
+        out.push_back(e);
+      }
+    }
+
+#ifdef G2D_ELF
+    /* defined dynamic symbols of an ELF file of the given class, until
+     * name is found. 1 if found, 0 if not, -1 if the file can't tell */
+    template<typename ehdr, typename shdr, typename sym>
+    int exports(std::ifstream & in, const std::string & name) {
+      in.seekg(0, std::ios::end);
+      unsigned long long length = in.tellg();
+      ehdr eh;
+      in.seekg(0);
+      if (!in.read((char *) &eh, sizeof(eh)) || eh.e_shentsize != sizeof(shdr) || eh.e_shnum == 0) return -1;
+      if (eh.e_shoff + (unsigned long long) eh.e_shnum * sizeof(shdr) > length) return -1;
+
+      std::vector<shdr> sections(eh.e_shnum);
+      in.seekg(eh.e_shoff);
+      if (!in.read((char *) &sections[0], sizeof(shdr) * sections.size())) return -1;
+
+      for (size_t i = 0; i < sections.size(); i++) {
+        const shdr & symtab = sections[i];
+        if (symtab.sh_type != SHT_DYNSYM || symtab.sh_entsize != sizeof(sym) || symtab.sh_link >= sections.size()) continue;
+        const shdr & strtab = sections[symtab.sh_link];
+        if (symtab.sh_offset + symtab.sh_size > length || strtab.sh_offset + strtab.sh_size > length) return -1;
+
+        std::vector<sym> syms(symtab.sh_size / sizeof(sym));
+        std::vector<char> strings(strtab.sh_size + 1, 0);
+        if (syms.empty() || strtab.sh_size == 0) return 0;
+        in.seekg(symtab.sh_offset);
+        if (!in.read((char *) &syms[0], sizeof(sym) * syms.size())) return -1;
+        in.seekg(strtab.sh_offset);
+        if (!in.read(&strings[0], strtab.sh_size)) return -1;
+
+        for (size_t s = 0; s < syms.size(); s++) {
+          if (syms[s].st_shndx == SHN_UNDEF || syms[s].st_name >= strtab.sh_size) continue;
+          if (name == &strings[syms[s].st_name]) return 1;
+        }
+        return 0;
+      }
+      return 0;
+    }
+#endif
+
+    /* whether a library exports a symbol, -1 if it can't be told */
+    int exports(const std::string & file, const std::string & name) {
+#ifdef G2D_ELF
+      std::ifstream in(file.c_str(), std::ios::binary);
+      unsigned char ident[EI_NIDENT];
+      if (!in.read((char *) ident, EI_NIDENT)) return -1;
+      if (ident[EI_MAG0] != ELFMAG0 || ident[EI_MAG1] != ELFMAG1 || ident[EI_MAG2] != ELFMAG2 || ident[EI_MAG3] != ELFMAG3) return -1;
+
+      /* a library of another byte order would not load anyway */
+      const unsigned short one = 1;
+      unsigned char order = (*(const unsigned char *) &one == 1) ? ELFDATA2LSB : ELFDATA2MSB;
+      if (ident[EI_DATA] != order) return -1;
+      if (ident[EI_CLASS] == ELFCLASS64) return exports<Elf64_Ehdr, Elf64_Shdr, Elf64_Sym>(in, name);
+      if (ident[EI_CLASS] == ELFCLASS32) return exports<Elf32_Ehdr, Elf32_Shdr, Elf32_Sym>(in, name);
+      return -1;
+#else
+      return -1;
+#endif
+    }
+
+    /* reads the exports of a library, leaving it unknown if they can't be read */
+    void probe(catalog::entry & e) {
+      int found = exports(e.file, e.family + "_" + e.type + "_build");
+      if (found < 0) return;
+      e.known = true;
+      e.valid = (found == 1);
+    }
+  }
+
+  bool catalog::read(const std::string & manifest) {
+    std::ifstream in(manifest.c_str());
+    if (!in) return false;
+    std::string line;
+    if (!std::getline(in, line) || line != "gear2d-manifest 1") return false;
+
+    /* mtime size valid family type file, the file taking the rest of the line */
+    while (std::getline(in, line)) {
+      std::istringstream fields(line);
+      entry e;
+      int valid = 0;
+      if (!(fields >> e.mtime >> e.size >> valid >> e.family >> e.type)) continue;
+      std::getline(fields >> std::ws, e.file);
+      if (e.file == "") continue;
+      e.known = true;
+      e.valid = (valid != 0);
+      remembered[e.file] = e;
+    }
+    return true;
+  }
+
+  bool catalog::write(const std::string & manifest) const {
+    std::ofstream out(manifest.c_str(), std::ios::trunc);
+    if (!out) return false;
+    out << "gear2d-manifest 1\n";
+    for (size_t i = 0; i < found.size(); i++) {
+      const entry & e = found[i];
+      if (!e.known) continue;
+      out << e.mtime << ' ' << e.size << ' ' << (e.valid ? 1 : 0) << ' ' << e.family << ' ' << e.type << ' ' << e.file << '\n';
+    }
+    return (bool)out;
+  }
+
+  void catalog::scan(const std::string & compath, const std::string & prefix, const std::string & suffix, threadpool * pool) {
+    found.clear();
+
+    /* every family directory of every path, in compath order */
+    std::vector<std::string> paths;
+    split(paths, compath, ',');
+    std::vector<std::string> dirs, families;
+    for (size_t i = 0; i < paths.size(); i++) {
+      std::string path = trim(paths[i]);
+      if (path == "") continue;
+      std::vector<std::string> names;
+      list(path, true, names);
+      for (size_t j = 0; j < names.size(); j++) {
+        dirs.push_back(path + "/" + names[j]);
+        families.push_back(names[j]);
+      }
+    }
+
+    /* each directory fills its own list, so the walkers share nothing */
+    std::vector<std::vector<entry> > walked(dirs.size());
+    if (pool != 0) {
+      threadpool::batch done;
+      for (size_t i = 0; i < dirs.size(); i++) {
+        pool->push(done, [&, i] { walk(dirs[i], families[i], prefix, suffix, walked[i]); });
+      }
+      pool->wait(done);
+    } else {
+      for (size_t i = 0; i < dirs.size(); i++) walk(dirs[i], families[i], prefix, suffix, walked[i]);
+    }
+
+    /* first path to have a type wins */
+    std::set<std::pair<std::string, std::string> > seen;
+    for (size_t i = 0; i < walked.size(); i++) {
+      for (size_t j = 0; j < walked[i].size(); j++) {
+        entry & e = walked[i][j];
+        if (!seen.insert(std::make_pair(e.family, e.type)).second) continue;
+        std::map<std::string, entry>::iterator r = remembered.find(e.file);
+        if (r != remembered.end() && r->second.mtime == e.mtime && r->second.size == e.size
+          && r->second.family == e.family && r->second.type == e.type) {
+          e.known = true;
+          e.valid = r->second.valid;
+        }
+        found.push_back(e);
+      }
+    }
+  }
+
+  void catalog::probe(threadpool * pool) {
+    /* each library fills its own entry */
+    if (pool != 0) {
+      threadpool::batch done;
+      for (size_t i = 0; i < found.size(); i++) {
+        if (!found[i].known) pool->push(done, [this, i] { gear2d::probe(found[i]); });
+      }
+      pool->wait(done);
+    } else {
+      for (size_t i = 0; i < found.size(); i++) if (!found[i].known) gear2d::probe(found[i]);
+    }
+  }
+
+  std::vector<catalog::entry> & catalog::entries() {
+    return found;
+  }
+}
@@ -0,0 +1,99 @@
+#ifndef gear2d_catalog_h
+#define gear2d_catalog_h
+
+#include "definitions.h"
+
+#include <string>
+#include <vector>
+#include <map>
+
+/**
+ * @file catalog.h
+ * @brief Component libraries found in the compath.
+ *
+ * Without a catalog, loading a component tries every path of the
+ * compath in turn, failing on each one that doesn't have it. The catalog
+ * walks the compath once, every family directory at the same time, and
+ * remembers in a manifest on disk which libraries turned out to hold
+ * builders, so the next runs need not load them to know. */
+
+namespace gear2d {
+  class threadpool;
+
+  /**
+   * @brief Libraries under the compath, and what is known of them.
+   *
+   * Libraries are expected where the component factory looks for them,
+   * at <code>path/family/PREFIXtypeSUFFIX</code>. Each one is known by its
+   * file, modification time and size: when any of them changes, what the
+   * manifest said of it no longer holds. */
+  class g2dapi catalog {
+    public:
+      /** @brief A library found in the compath. */
+      struct entry {
+        entry() : mtime(0), size(0), known(false), valid(false) { }
+
+        std::string family;
+        std::string type;
+        std::string file;
+        long long mtime;
+        long long size;
+
+        /** @brief Whether the manifest already told if it is valid. */
+        bool known;
+
+        /** @brief Whether it holds the builder of its family and type. */
+        bool valid;
+      };
+
+    public:
+      /**
+       * @brief Reads what a previous run found.
+       * @param manifest Manifest file
+       * @return Whether the manifest could be read */
+      bool read(const std::string & manifest);
+
+      /**
+       * @brief Writes down what is known of the libraries found.
+       * @param manifest Manifest file
+       * @return Whether the manifest could be written
+       *
+       * Libraries whose validity is still unknown are left out. */
+      bool write(const std::string & manifest) const;
+
+      /**
+       * @brief Looks for libraries in the compath.
+       * @param compath Comma-separated list of paths
+       * @param prefix Library file prefix, like "lib"
+       * @param suffix Library file suffix, like ".so"
+       * @param pool Pool to walk the family directories in, or null to
+       * walk them one after the other
+       *
+       * When a type is in more than one path, the first path wins, as
+       * when the factory tries them in turn. Libraries the manifest knows,
+       * unchanged, come out known. */
+      void scan(const std::string & compath, const std::string & prefix, const std::string & suffix, threadpool * pool);
+
+      /**
+       * @brief Tells which libraries hold their builder, without loading them.
+       * @param pool Pool to read the libraries in, or null to read them
+       * one after the other
+       *
+       * Looks for the builder g2dcomponent exports among the dynamic
+       * symbols of each library found by scan() and not known yet. Only
+       * ELF libraries are read; the others, and those that can't be read,
+       * are left unknown, to be loaded to find out. */
+      void probe(threadpool * pool);
+
+      /** @brief Libraries found by the last scan. */
+      std::vector<entry> & entries();
+
+    private:
+      /* what the manifest says, by file */
+      std::map<std::string, entry> remembered;
+
+      std::vector<entry> found;
+  };
+}
+
+#endif
@@ -8,7 +8,7 @@
 
 #include <iostream>
 
-#define SOPREFIX "lib";
+#define SOPREFIX "lib"
 #ifdef _WIN32
 # define SOSUFFIX ".dll"
 # ifdef _MSC_VER
@@ -57,13 +57,26 @@ namespace gear2d {
     
     base::base()
     : cfactory(0)
+    , famslot(-1)
+    , comslot(0)
+    , removing(false)
+    , pooled(false)
+    , typeslot(-1)
+    , asleep(false)
+    , parked(false)
+    , restless(false)
+    , timers(0)
+    , alarm(0)
+    , release(0)
     {
     }
     
     base::~base() {
+      /* parameters of other objects outlive us, leave nothing dangling in them */
+      while (!hooking.empty()) hooking[hooking.size() - 1]->unhook(this);
     }
     
-    parameterbase * base::exists(const parameterbase::id & pid) {
+    parameterbase * base::exists(const symbol & pid) {
       return owner->get(pid);
     }
     
@@ -80,6 +93,11 @@ namespace gear2d {
       return owner->ofactory->locate(t);
     }
     
+    archetype * base::columns(object::type t) {
+      if (owner->ofactory == 0) return 0;
+      return owner->ofactory->columns(t);
+    }
+    
     object::id base::spawn(object::type t) {
       object::id obj = 0;
       if (owner->ofactory != 0) {
@@ -94,15 +112,45 @@ namespace gear2d {
     }
     
     component::base * base::clone() {
-      object::id other = spawn(owner->name());
-      other->copy(owner);
-      return other->component(this->family());
+      object::id other = 0;
+      if (owner->ofactory != 0) other = owner->ofactory->clone(owner);
+      else {
+        other = spawn(owner->name());
+        if (other != 0) other->copy(owner);
+      }
+      return (other != 0) ? other->component(this->family()) : 0;
+    }
+    
+    void base::dispose(base * c) {
+      if (c == 0) return;
+      if (c->release != 0) c->release(c);
+      else delete c;
     }
     
     void base::destroy() {
       owner->destroy();
     }
     
+    void base::sleep() {
+      engine::sleep(this, -1);
+    }
+    
+    void base::sleep(timediff seconds) {
+      engine::sleep(this, seconds < 0 ? 0 : seconds);
+    }
+    
+    void base::wake() {
+      engine::wake(this);
+    }
+    
+    bool base::sleeping() {
+      return asleep;
+    }
+    
+    void base::schedule(timediff seconds, const std::function<void()> & callback) {
+      engine::schedule(this, seconds, callback);
+    }
+    
     void base::handle(parameterbase::id pid, component::base * lastwrite, object::id owner) { ; }
     
     void base::load(std::string scene) {
@@ -173,6 +221,7 @@ namespace gear2d {
       if (t == "") t = f;
       if (b == 0) return;
       builders[f][t] = b;
+      object::family(f);
     }
     
     void factory::load(selector s, std::string file) throw (evil) {
@@ -181,7 +230,19 @@ namespace gear2d {
       f = s.family;
       t = s.type;
       if (t == "") t = f;
-      std::string buildername = s.family + "_" + s.type + "_build";
+      std::string buildername = f + "_" + t + "_build";
+      
+      /* linked in and enlisted, nothing to load */
+      if (file == "") {
+        buildertable::iterator famit = enlisted().find(f);
+        if (famit != enlisted().end() && famit->second.find(t) != famit->second.end()) {
+          trace("Found", buildername, "enlisted");
+          handlers[t] = nullptr;
+          builders[f][t] = famit->second[t];
+          object::family(f);
+          return;
+        }
+      }
 
 #ifdef ANDROID
       void * handle = SDL_LoadObject("libmain.so");
@@ -197,10 +258,17 @@ namespace gear2d {
         trace("Found", buildername, "internally at address", combuilder);
         handlers[t] = nullptr;
         builders[f][t] = combuilder;
+        object::family(f);
         return;
       }
         
         
+      /* scan() already knows where it is */
+      if (file == "") {
+        std::map<component::family, std::map<component::type, std::string> >::iterator famit = libraries.find(f);
+        if (famit != libraries.end() && famit->second.find(t) != famit->second.end()) file = famit->second[t];
+      }
+        
       factory::handler comhandler = 0;
       /* TODO: check if we're in windows or linux */
       if (file == "") {
@@ -232,13 +300,16 @@ namespace gear2d {
       if (combuilder == 0) {
         trace.e("I cannot recognize", file, "as an valid gear2d component. It will NOT be loaded");
         trace.e("Error was:", SDL_GetError());
-        SDL_UnloadObject(comhandler);
+        
+        /* loading it may have enlisted builders of other names, which
+         * must keep pointing to mapped code. leave it loaded */
         return;
       }
       
       /* register the handler and the builder */
       handlers[t] = comhandler;
       builders[f][t] = combuilder;
+      object::family(f);
       
       trace("Sucessfully loaded a builder for", t, "from", file);
       
@@ -247,13 +318,26 @@ namespace gear2d {
     
     base * factory::build(component::selector s) {
       modinfo("component-factory");
+      base * component = build(find(s));
+      if (component != 0) trace.i("Component type", component->type(), "sucessfuly built!");
+      return component;
+    }
+    
+    base * factory::build(factory::builder b) {
+      if (b == 0) return 0;
+      
+      /* build it with the given function */
+      base * component = b();
+      component->cfactory = this;
+      return component;
+    }
+    
+    factory::builder factory::find(component::selector s) {
       component::family f; component::type t;
       f = s.family;
       t = s.type;
       if (t == "") t = f;
       
-      factory::builder b;
-      
       /* try to locate component based on type */
       buildertable::iterator famit = builders.find(f);
       
@@ -262,20 +346,81 @@ namespace gear2d {
         return 0;
       }
       
-      std::map<component::type, factory::builder>::iterator typit = famit->second.end();
-      if (f != t) { typit = famit->second.find(t); }
-      else if (famit->second.size() > 0) { typit = famit->second.begin(); }
+      /* a family alone picks the type named after it, or else any */
+      std::map<component::type, factory::builder>::iterator typit = famit->second.find(t);
+      if (typit == famit->second.end() && f == t && famit->second.size() > 0) { typit = famit->second.begin(); }
       
       if (typit == famit->second.end()) {
         return 0;
       }
       
-      /* build it with the given function */
-      b = typit->second;
-      base * component = b();
-      component->cfactory = this;
-      trace.i("Component type", t, "sucessfuly built!");
-      return component;
+      return typit->second;
+    }
+    
+    void factory::enlist(component::family f, component::type t, factory::builder b) {
+      if (t == "") t = f;
+      if (b == 0) return;
+      enlisted()[f][t] = b;
+      object::family(f);
+    }
+    
+    factory::buildertable & factory::enlisted() {
+      static buildertable table;
+      return table;
+    }
+    
+    const factory::requirement & factory::dependencies(component::base * c) {
+      std::map<component::type, requirement> & types = requirements[c->family()];
+      std::map<component::type, requirement>::iterator it = types.find(c->type());
+      if (it == types.end()) {
+        it = types.insert(std::make_pair(c->type(), requirement())).first;
+        std::vector<std::string> listed;
+        split(listed, c->depends(), ' ');
+        for (size_t i = 0; i < listed.size(); i++) {
+          component::selector s(listed[i]);
+          it->second.needs.push_back(s);
+          it->second.families.push_back(object::family(s.family));
+        }
+      }
+      return it->second;
+    }
+    
+    void factory::scan(const std::string & manifest, threadpool * pool) {
+      modinfo("component-factory");
+      catalog c;
+      if (manifest != "" && !c.read(manifest)) trace.i("No manifest at", manifest, "yet, probing every library");
+      c.scan(compath, SOPREFIX, SOSUFFIX, pool);
+      
+      /* whatever was not known goes in the manifest, probed or loaded */
+      std::vector<catalog::entry> & found = c.entries();
+      bool changed = false;
+      for (size_t i = 0; i < found.size(); i++) if (!found[i].known) changed = true;
+      c.probe(pool);
+      
+      /* what could not be read is loaded to find out. loading runs the
+       * library's static initializers, which register builders, so it is
+       * done one at a time. they stay loaded, valid or not, as those
+       * builders point into them */
+      for (size_t i = 0; i < found.size(); i++) {
+        catalog::entry & e = found[i];
+        if (!e.known) {
+          component::selector s(e.family, e.type);
+          try {
+            load(s, e.file);
+            buildertable::iterator famit = builders.find(e.family);
+            e.valid = (famit != builders.end() && famit->second.find(e.type) != famit->second.end());
+          } catch (evil & ev) {
+            trace.w(ev.what());
+            e.valid = false;
+          }
+          e.known = true;
+          changed = true;
+        }
+        if (e.valid) libraries[e.family][e.type] = e.file;
+      }
+      trace.i("Found", libraries.size(), "component families in", compath);
+      
+      if (manifest != "" && changed && !c.write(manifest)) trace.w("Could not write the manifest", manifest);
     }
     
     factory::~factory() {
@@ -13,6 +13,9 @@ using std::endl;
 #include "definitions.h"
 #include "parameter.h"
 #include "object.h"
+#include "timerwheel.h"
+#include "slab.h"
+#include "catalog.h"
 
 /** 
  * @file component.h
@@ -24,11 +27,17 @@ using std::endl;
  */
 
 
-/** Macros to ease the process of declaring a new component */
+/** Macros to ease the process of declaring a new component.
+ * Besides exporting a builder to be found in plugins, the component
+ * is enlisted at static initialization, so components linked into the
+ * executable are found without loading anything. Components are built
+ * in the slabs of their type, see component::base::allocate(). */
 #if defined (_WIN32) && defined (_MSC_VER)
-#  define g2dcomponent(x, g2dfamily, g2dtype) extern "C" { __declspec(dllexport) gear2d::component::base * g2dfamily##_##g2dtype##_##build() { return new x; } }
+#  define g2dcomponent(x, g2dfamily, g2dtype) extern "C" { __declspec(dllexport) gear2d::component::base * g2dfamily##_##g2dtype##_##build() { return gear2d::component::base::allocate<x>(); } } \
+  static gear2d::component::enlisted g2dfamily##_##g2dtype##_##enlisted(#g2dfamily, #g2dtype, g2dfamily##_##g2dtype##_##build);
 #else
-#  define g2dcomponent(x, g2dfamily, g2dtype) extern "C" { gear2d::component::base * g2dfamily##_##g2dtype##_##build() { return new x; } }
+#  define g2dcomponent(x, g2dfamily, g2dtype) extern "C" { gear2d::component::base * g2dfamily##_##g2dtype##_##build() { return gear2d::component::base::allocate<x>(); } } \
+  static gear2d::component::enlisted g2dfamily##_##g2dtype##_##enlisted(#g2dfamily, #g2dtype, g2dfamily##_##g2dtype##_##build);
 #endif
 
 
@@ -135,6 +144,7 @@ namespace gear2d {
       friend class gear2d::object;
       friend class gear2d::engine;
       friend class gear2d::component::factory;
+      friend class gear2d::parameterbase;
       
       public:
         /**
@@ -175,6 +185,9 @@ namespace gear2d {
               
               auto it = (*sig).find(pid);
               if (it != (*sig).end()) {
+                /* objects of the same type evaluate the same strings, do it once */
+                blueprint * print = (com->owner != 0) ? com->owner->print : 0;
+                if (print != 0) return (*com).fetch<datatype>(pid, print->value<datatype>(pid, it->second, def));
                 return (*com).fetch<datatype>(pid, eval<datatype>(it->second, def));
               } else {
                 return (*com).fetch<datatype>(pid, def);
@@ -206,6 +219,30 @@ namespace gear2d {
          * Defaults to type() */
         virtual component::family family() { return type(); }
         
+        /**
+         * @brief Whether this family can be updated alongside the others.
+         * 
+         * When the scene runs with more than one thread (@p threads:),
+         * families whose components return true here are updated by worker
+         * threads, concurrently with the rest of the frame. Only do so if
+         * update() touches nothing but its own object: destroying it is fine,
+         * but spawning objects or writing to other objects is not. Nor may
+         * other families of the same phase write to the parameters of those
+         * objects, as they run at the same time; schedule them in another
+         * phase. Families can also be declared independent with the
+         * @p independent: scene key. */
+        virtual bool independent() { return false; }
+        
+        /**
+         * @brief Whether components of this family can update in parallel.
+         * 
+         * When the scene runs with more than one thread (@p threads:), the
+         * list of a family whose components return true here is split in
+         * chunks that are updated by the worker threads at the same time. The
+         * rules of independent() apply: update() must touch nothing but its
+         * own object. */
+        virtual bool parallel() { return false; }
+        
         /**
          * @brief Components that must exists before its attachment.
          * 
@@ -259,6 +296,23 @@ namespace gear2d {
         * All parameters are still valid in this phase.
         */
         virtual void destroyed() { }
+        
+        /**
+         * @brief Prepares this component to serve a reused object.
+         * @param sig Object original signature
+         * @return true if the component can be reused, false to have it
+         * deleted and a new one built and set up in its place
+         * 
+         * Objects with @p pool: in their signature are kept after being
+         * destroyed and handed out again by spawn(). By then the object
+         * parameters are back to the values they had right after it was
+         * first built, and hooks from other objects are gone. Override this
+         * to bring whatever state is kept in the component itself back to
+         * how setup() left it, then return true. Links and hooks made in
+         * setup() remain valid; hooks in other objects were silent while
+         * the object was pooled and are heard again. Timers were cancelled
+         * when the object was destroyed, schedule them again here. */
+        virtual bool reset(object::signature & sig) { return false; }
        
         /**
          * @brief Returns a link to the parameter.
@@ -269,7 +323,7 @@ namespace gear2d {
          * setup() or after. Never at construction time.
          */
         template<typename basetype>
-        link<basetype> fetch(const parameterbase::id & pid, const basetype & init = basetype()) {
+        link<basetype> fetch(const symbol & pid, const basetype & init = basetype()) {
           if (!exists(pid)) write(pid, init);
           parameter<basetype> * p = access<basetype>(pid);
           return link<basetype>(p, this);
@@ -283,7 +337,7 @@ namespace gear2d {
          * 
          * Reads a parameter and store it on target. */
         template<typename datatype>
-        void read(const parameterbase::id & pid, datatype & target) {
+        void read(const symbol & pid, datatype & target) {
           parameter<datatype> * v = access<datatype>(pid);
           target = v->get();
         }
@@ -293,7 +347,7 @@ namespace gear2d {
          * @param pid Parameter id to be read
          * @warning The parameter will be created if it does not exists */
         template<typename datatype>
-        datatype read(const parameterbase::id & pid) {
+        datatype read(const symbol & pid) {
           parameter<datatype> * v = access<datatype>(pid);
           return v->get();
         }
@@ -307,14 +361,14 @@ namespace gear2d {
          * @warning Be careful about type promotion. Be explicit if necessary.
          * @warning The parameter will be created if it does not exists */
         template<typename datatype>
-        void write(const parameterbase::id & pid, const datatype & source) {
+        void write(const symbol & pid, const datatype & source) {
           parameter<datatype> * v = access<datatype>(pid);
           v->lastwrite = this;
           v->set(source);
         }
         
         template<typename datatype>
-        void write(parameterbase::id pid, const link<datatype> & source) {
+        void write(const symbol & pid, const link<datatype> & source) {
           parameter<datatype> * v = access<datatype>(pid);
           v->lastwrite = this;
           v->set((datatype)source);
@@ -333,7 +387,7 @@ namespace gear2d {
          * function.
          */
         template<typename datatype>
-        void write(object::id oid, const parameterbase::id & pid, const datatype & source) {
+        void write(object::id oid, const symbol & pid, const datatype & source) {
           parameter<datatype> * v = (parameter<datatype> *) oid->get(pid);
           if (v == 0) return;
           v->lastwrite = this;
@@ -347,7 +401,7 @@ namespace gear2d {
          * @warning Be careful about type promotion. Be explicit if necessary.
          */
         template<typename datatype>
-        void add(parameterbase::id pid, const datatype & sum) {
+        void add(const symbol & pid, const datatype & sum) {
           datatype t;
           read(pid, t);
           write(pid, t + sum);
@@ -364,8 +418,8 @@ namespace gear2d {
          * needs. Look at @ref eval for more info on how to do that.
          */
         template<typename datatype>
-        void init(const parameterbase::id & pid, std::string raw, datatype def) {
-          if (owner->get(pid) != 0) throw evil(this->type() + "tried init(" + pid + ")" + " but its already set.");
+        void init(const symbol & pid, std::string raw, datatype def) {
+          if (owner->get(pid) != 0) throw evil(this->type() + "tried init(" + pid.name() + ")" + " but its already set.");
           if (raw == "") write(pid, def);
           else write(pid, eval<datatype>(raw, def));
           parameterbase::value v = owner->get(pid);
@@ -393,8 +447,8 @@ namespace gear2d {
          * if it do not exists, so be assured to use bind() before.
          */
         template <typename datatype>
-        void bind(const parameterbase::id & pid, datatype & raw) throw (evil) {
-          if (owner->get(pid) != 0) throw evil(this->type() + " tried bind(" + pid + ")" + " but its already set.");
+        void bind(const symbol & pid, datatype & raw) throw (evil) {
+          if (owner->get(pid) != 0) throw evil(this->type() + " tried bind(" + pid.name() + ")" + " but its already set.");
           parameter<datatype> * p = new parameter<datatype>(&raw);
           p->dodestroy = false;
           owner->set(pid, p);
@@ -413,7 +467,7 @@ namespace gear2d {
          * if it does not exists.
          */
         template<typename datatype>
-        const datatype & raw(const parameterbase::id & pid) {
+        const datatype & raw(const symbol & pid) {
           parameter<datatype> * v = access<datatype>(pid);
           return *(*v);
         }
@@ -432,11 +486,11 @@ namespace gear2d {
          * parameter is coming from, its better to add it to the dependency
          * list, no?
          */
-        void hook(const parameterbase::id & pid) {
+        void hook(const symbol & pid) {
           hook(pid, 0);
         }
         
-        void unhook(const parameterbase::id & pid) {
+        void unhook(const symbol & pid) {
           parameterbase::value v = owner->get(pid);
           if (v == 0) return;
           v->unhook(this);
@@ -456,7 +510,7 @@ namespace gear2d {
          * will fail silently. Use <code>if (exists(pid)) hook(pid)</code> if you
          * want to know if/when it fails.
          */
-        void hook(const parameterbase::id & pid, component::call handlerfp) {
+        void hook(const symbol & pid, component::call handlerfp) {
           parameterbase::value v = owner->get(pid);
           if (v == 0) return;
           v->hook(this, handlerfp);
@@ -470,7 +524,7 @@ namespace gear2d {
          * Add this component as a listener to the parameter in another
          * component. Owner will be passed in handle() as a way of
          * knowing if it is a parameter on your object or on another */
-        void hook(component::base * c, const parameterbase::id & pid) {
+        void hook(component::base * c, const symbol & pid) {
           if (c == 0) return;
           parameterbase::value v = c->owner->get(pid);
           if (v == 0) return;
@@ -482,7 +536,7 @@ namespace gear2d {
          * @brief Unhook this component in a parameter in another component
          * @param c Component to unhook in
          * @param pid Parameter id */
-        void unhook(component::base * c, const parameterbase::id & pid) {
+        void unhook(component::base * c, const symbol & pid) {
           if (c == 0) return;
           parameterbase::value v = c->owner->get(pid);
           if (v == 0) return;
@@ -498,7 +552,7 @@ namespace gear2d {
         * Add this component as a listener to the parameter in another
         * component. Owner will be passed in handle() as a way of
         * knowing if it is a parameter on your object or on another */
-        void hook(component::base * c, const parameterbase::id & pid, component::call handlerfp) {
+        void hook(component::base * c, const symbol & pid, component::call handlerfp) {
           if (c == 0) return;
           parameterbase::value v = c->owner->get(pid);
           if (v == 0) return;
@@ -510,7 +564,7 @@ namespace gear2d {
          * @param pid Parameter id
          * @return parameter address if it does exists, (null) 0 if not.
          * This queries if the parameter exists. */
-        parameterbase * exists(const parameterbase::id & pid);
+        parameterbase * exists(const symbol & pid);
 
         /**
          * @brief Build another component based on selector.
@@ -542,6 +596,15 @@ namespace gear2d {
          */
         object::id locate(object::type t);
         
+        /**
+         * @brief Column storage of an object type.
+         * @param t Type of the objects
+         * @return The storage, or null if the type lists no @p columns:
+         * 
+         * Use this to go over a parameter of every object of a type at
+         * once. See gear2d::archetype. */
+        archetype * columns(object::type t);
+        
         /**
          * @brief Clone the parent game object.
          * @return A pointer to a compononent of the same type that called clone()
@@ -558,6 +621,43 @@ namespace gear2d {
          * destruction list too. */
         void destroy();
         
+        /**
+         * @brief Stops updating this component until woken.
+         * 
+         * The component leaves the update pipeline from the next frame
+         * on and costs nothing until wake() is called, either by itself
+         * (from a scheduled callback) or by anyone else, or until a
+         * parameter it hooked is written. handle() is still called. */
+        void sleep();
+        
+        /**
+         * @brief Stops updating this component for a while.
+         * @param seconds Time to sleep, in seconds
+         * 
+         * Same as sleep(), but wake() is called by itself once the time
+         * has passed. Waking earlier cancels it. */
+        void sleep(timediff seconds);
+        
+        /**
+         * @brief Puts a sleeping component back in the update pipeline.
+         * 
+         * It gets updated again from the next frame on. Does nothing
+         * if the component is not sleeping. */
+        void wake();
+        
+        /** @brief Whether this component is sleeping. */
+        bool sleeping();
+        
+        /**
+         * @brief Calls something after a while.
+         * @param seconds Time to wait, in seconds
+         * @param callback What to call
+         * 
+         * The callback runs in the main thread at the beginning of a frame,
+         * whether this component is sleeping or not, unless the component
+         * is removed before. Time passes at the frame pace. */
+        void schedule(timediff seconds, const std::function<void()> & callback);
+        
         /**
          * @brief Loads a new scene configuration.
          * @param scene Scene name
@@ -566,12 +666,9 @@ namespace gear2d {
         
       private:
         template<typename datatype>
-        parameter<datatype> * access(const parameterbase::id & pid) {
+        parameter<datatype> * access(const symbol & pid) {
           parameterbase::value v = owner->get(pid);
-          if (v == 0) {
-            v = new parameter<datatype>;
-            owner->set(pid, v);
-          }
+          if (v == 0) v = owner->make<datatype>(pid);
           return (parameter<datatype>*)v;
         }
         
@@ -582,6 +679,68 @@ namespace gear2d {
       private:
         // component factory that build us
         component::factory * cfactory;
+        
+        // engine pipeline bookkeeping: family slot, position in it, pending removal
+        int famslot;
+        size_t comslot;
+        bool removing;
+        
+        // set while our object waits in a pool: hooks stay put but stay silent
+        bool pooled;
+        
+        // parameters we hooked, of any object, so that we unhook when we go
+        smallvector<parameterbase *, 2> hooking;
+        
+        // profiler bookkeeping: index of this type's section
+        int typeslot;
+        
+        // sleep bookkeeping: wanted state, actual state, waiting for the engine to switch them
+        bool asleep;
+        bool parked;
+        bool restless;
+        
+        // pending timers, and the one that wakes us up
+        timerwheel::timer * timers;
+        timerwheel::timer * alarm;
+        
+        // gives our memory back to where allocate() took it, null after a plain new
+        void (*release)(base *);
+        
+        template<typename comtype>
+        static void slabrelease(base * c) {
+          comtype * com = static_cast<comtype *>(c);
+          com->~comtype();
+          slab<comtype>::shared().give(com);
+        }
+        
+      public:
+        /**
+         * @brief Build a component in the slabs of its type.
+         * @return The new component
+         * 
+         * Components of the same type end up next to each other in memory,
+         * so going over a family is kind to the cache. Builders made by
+         * g2dcomponent use this. Components built like this must go away
+         * through dispose(), never through delete.
+         * @see gear2d::slab */
+        template<typename comtype>
+        static base * allocate() {
+          void * memory = slab<comtype>::shared().take();
+          base * com;
+          try {
+            com = ::new (memory) comtype;
+          } catch (...) {
+            slab<comtype>::shared().give(memory);
+            throw;
+          }
+          com->release = &slabrelease<comtype>;
+          return com;
+        }
+        
+        /**
+         * @brief Destroy a component, whether it came from allocate() or new.
+         * @param c Component to destroy */
+        static void dispose(base * c);
     };
     
     class factory {
@@ -614,6 +773,52 @@ namespace gear2d {
          * component was not found, a null pointer will be returned */
         base * build(component::selector s);
         
+        /**
+         * @brief Find the builder of a component.
+         * @param s Family and type of the component
+         * @return The builder registered for @p s, or null
+         * 
+         * Keep it to build components of that type with build(builder)
+         * without looking them up again. */
+        factory::builder find(component::selector s);
+        
+        /**
+         * @brief Register a builder for every factory.
+         * @param f Family of the component
+         * @param t Type of the component
+         * @param b Its builder
+         * 
+         * Factories look here before loading anything, so components
+         * registered this way cost no library loading nor symbol lookup.
+         * g2dcomponent does this for you. When linking components from a
+         * static library, make sure the linker keeps them, as nothing else
+         * refers to them. */
+        static void enlist(component::family f, component::type t, factory::builder b);
+        
+        /**
+         * @brief Build a component with a builder found before.
+         * @param b Builder returned by find()
+         * @return A pointer to the component, or null if @p b is null */
+        base * build(factory::builder b);
+        
+        /** @brief Dependencies of a component type, parsed. */
+        struct requirement {
+          /** @brief Selectors of the components depended on */
+          std::vector<component::selector> needs;
+          
+          /** @brief Family id of each of them, see object::family() */
+          std::vector<int> families;
+        };
+        
+        /**
+         * @brief Dependencies of a component.
+         * @param c Component to look at
+         * @return What @p c depends on
+         * 
+         * depends() is parsed once per family and type, the result is
+         * kept for the next components of the same type. */
+        const requirement & dependencies(component::base * c);
+        
         /**
          * @brief Load a componend from a shared plugin
          * @param s A selector in the form family/type
@@ -621,6 +826,18 @@ namespace gear2d {
          * @throw evil */
         void load(component::selector s, std::string filepath = "") throw (evil);
         
+        /**
+         * @brief Find the component libraries in compath.
+         * @param manifest File to keep what was found between runs
+         * @param pool Pool to search in, or null
+         * 
+         * Libraries the manifest does not know, or that changed since,
+         * are read to see if they export a builder, see catalog::probe().
+         * Those that can't be read are loaded to find out, and stay loaded.
+         * Afterwards load() goes straight to the library of a component
+         * instead of trying every path of compath. */
+        void scan(const std::string & manifest, threadpool * pool);
+        
         ~factory();
         
       private:
@@ -630,6 +847,26 @@ namespace gear2d {
         typedef void * handler;
         typedef std::map<component::type, handler> handlertable;
         handlertable handlers;
+        
+        /* libraries found by scan() holding a builder */
+        std::map<component::family, std::map<component::type, std::string> > libraries;
+        
+        typedef std::map<component::family, std::map<component::type, requirement> > dependencytable;
+        dependencytable requirements;
+        
+        /* builders enlisted at static initialization */
+        static buildertable & enlisted();
+    };
+    
+    /**
+     * @brief Enlists a builder when constructed.
+     * 
+     * A static one is what g2dcomponent uses to register components
+     * as the program starts. */
+    struct g2dapi enlisted {
+      enlisted(const char * family, const char * type, factory::builder b) {
+        factory::enlist(family, type, b);
+      }
     };
   }
 }
@@ -16,6 +16,8 @@
 #include <functional>
 //#include <locale>
 
+#include "parser.h"
+
 /** 
  * @file definitions.h
  * @brief Common definitions and useful functions.
@@ -212,8 +214,9 @@ namespace gear2d {
    * This tries to do a lexical cast from the raw string to the
    * destination (datatype) type.
    * 
-   * You can (and should!) do a template specialization of this method
-   * if you know better than this function. Example:
+   * Numbers are parsed by hand, other types go through a stringstream.
+   * To teach it a new type, specialize gear2d::parser, or do a
+   * template specialization of this method. Example:
    * @code
    * template<> eval<your-fancy-customtype>(std::string rawstr, your-fancy-customtype def) {
    *     // do your stuff to convert raw string to your-fancy-type
@@ -229,12 +232,8 @@ namespace gear2d {
    */
   template<typename datatype>
   datatype eval(const std::string & raw, const datatype & def = datatype()) {
-    std::stringstream sstr;
     datatype t;
-    sstr << raw;
-    sstr >> t;
-    if (sstr.fail()) t = def;
-    return t;
+    return parser<datatype>::parse(raw, t) ? t : def;
   }
   
   template<>
@@ -246,9 +245,13 @@ namespace gear2d {
   template<>
   inline bool eval<bool>(const std::string & raw, const bool & def) {
     if (raw.empty()) return def;
-    std::string e = raw; strtolower(e);
-    if (e.compare("true") == 0 || raw[0] == '1') return true;
-    else return false;
+    if (raw[0] == '1') return true;
+    
+    /* "true" in any case, without a lower-case copy */
+    const char * t = "true";
+    if (raw.size() != 4) return false;
+    for (size_t i = 0; i < 4; i++) if (std::tolower((unsigned char)raw[i]) != t[i]) return false;
+    return true;
   }
 
  /**
@@ -3,6 +3,8 @@
 #include "object.h" 
 #include "logtrace.h"
 #include "sigfile.h"
+#include "threadpool.h"
+#include "timerwheel.h"
 
 
 #include <fstream>
@@ -11,7 +13,7 @@
 #include <cstdio>
 #include <ctime>
 #include "SDL.h"
-#include "SDL2_framerate.h"
+#include "pacer.h"
 
 #include <algorithm>
 
@@ -39,12 +41,37 @@ namespace gear2d {
   std::map<std::string, std::string> * engine::config;
   component::factory * engine::cfactory;
   object::factory * engine::ofactory;
-  std::map<component::type, std::set<component::base *> > * engine::components;
-  std::set<component::base *> * engine::removedcom;
-  std::set<object::id> * engine::destroyedobj;
+  std::vector<engine::pipeline> * engine::components;
+  std::unordered_map<symbol, int> * engine::famslots;
+  engine::plan * engine::schedules;
+  bool engine::rescheduling;
+  std::vector<component::base *> * engine::removedcom;
+  std::vector<object::id> * engine::destroyedobj;
   bool engine::initialized;
   bool engine::started;
+  bool engine::isheadless;
   std::string * engine::nextscene;
+  threadpool * engine::workers;
+  std::set<component::family> * engine::independents;
+  std::vector<component::base *> * engine::addedcom;
+  bool engine::updating;
+  std::mutex engine::pipelock;
+  profiler * engine::prof;
+  bool engine::profiling;
+  std::string * engine::profilecsv;
+  engine::phasetiming engine::phases;
+  std::unordered_map<symbol, int> * engine::typeslots;
+  std::vector<profiler::section *> * engine::typesections;
+  timediff engine::timestep;
+  int engine::maxsteps;
+  timediff engine::accumulator;
+  timediff engine::interpolation;
+  std::set<component::family> * engine::variables;
+  pacer * engine::pace;
+  timerwheel * engine::wheel;
+  std::vector<component::base *> * engine::restless;
+  bool engine::deferring;
+  long engine::frames;
   
   const char * engine::version() { return libraryversion; }
   
@@ -54,19 +81,292 @@ namespace gear2d {
       trace("Initialize the engine before attaching a component to an object");
     }
     if (c == 0) return;
-    (*components)[c->family()].insert(c); 
+    
+    /* the pipeline can't change under the workers' feet */
+    if (updating) {
+      std::lock_guard<std::mutex> guard(pipelock);
+      addedcom->push_back(c);
+      return;
+    }
+    
+    /* first component of this family in the scene: give it a slot */
+    if (c->famslot < 0) {
+      c->famslot = familyslot(c->family());
+      pipeline & p = (*components)[c->famslot];
+      if (!p.traits) {
+        p.independent = p.independent || c->independent();
+        p.parallel = c->parallel();
+        p.traits = true;
+      }
+    }
+    
+    if (profiling && c->typeslot < 0) {
+      symbol t = c->type();
+      std::unordered_map<symbol, int>::iterator it = typeslots->find(t);
+      if (it == typeslots->end()) {
+        it = typeslots->insert(std::make_pair(t, (int)typesections->size())).first;
+        typesections->push_back(prof->get("type:" + t.name()));
+      }
+      c->typeslot = it->second;
+    }
+    
+    /* components that fell asleep before joining go straight to bed */
+    pipeline & p = (*components)[c->famslot];
+    std::vector<component::base *> & coms = c->asleep ? p.sleeping : p.coms;
+    c->parked = c->asleep;
+    c->comslot = coms.size();
+    c->removing = false;
+    coms.push_back(c);
+  }
+  
+  int engine::familyslot(const symbol & f) {
+    std::unordered_map<symbol, int>::iterator it = famslots->find(f);
+    if (it != famslots->end()) return it->second;
+    
+    int slot = components->size();
+    components->push_back(pipeline());
+    pipeline & p = components->back();
+    p.family = f.name();
+    p.independent = independents->count(f.name()) != 0;
+    p.parallel = false;
+    p.variable = variables->count(f.name()) != 0;
+    p.declared = false;
+    p.phase = 1;
+    p.traits = false;
+    p.timing = profiling ? prof->get("family:" + f.name()) : 0;
+    famslots->insert(std::make_pair(f, slot));
+    
+    /* the running pass keeps its schedule, the new family joins the next one */
+    rescheduling = true;
+    return slot;
+  }
+  
+  void engine::reschedule() {
+    for (int v = 0; v < 2; v++) {
+      plan & s = schedules[v];
+      s.slots.clear();
+      for (int phase = 0; phase < 3; phase++) {
+        /* families the scene listed come first, in its order. they
+         * got their slots while loading it, so slot order is that order */
+        for (size_t slot = 0; slot < components->size(); slot++) {
+          pipeline & p = (*components)[slot];
+          if (!p.declared || p.phase != phase) continue;
+          if ((timestep <= 0 || p.variable) == (v == 1)) s.slots.push_back(slot);
+        }
+        
+        /* everyone else is updated with the update phase, by name */
+        if (phase == 1) {
+          size_t first = s.slots.size();
+          for (size_t slot = 0; slot < components->size(); slot++) {
+            pipeline & p = (*components)[slot];
+            if (p.declared) continue;
+            if ((timestep <= 0 || p.variable) == (v == 1)) s.slots.push_back(slot);
+          }
+          std::vector<pipeline> & families = *components;
+          std::sort(s.slots.begin() + first, s.slots.end(), [&families] (int a, int b) {
+            return families[a].family < families[b].family;
+          });
+        }
+        s.ends[phase] = s.slots.size();
+      }
+    }
+    rescheduling = false;
+  }
+  
+  void engine::unlink(component::base * c) {
+    if (c->famslot < 0) return;
+    pipeline & p = (*components)[c->famslot];
+    std::vector<component::base *> & coms = c->parked ? p.sleeping : p.coms;
+    if (c->comslot >= coms.size() || coms[c->comslot] != c) return;
+    component::base * last = coms.back();
+    coms[c->comslot] = last;
+    last->comslot = c->comslot;
+    coms.pop_back();
   }
 
   void engine::remove(component::base * c, bool rightnow) {
-    if (rightnow == false) removedcom->insert(c);
-    else {
-      (*components)[c->family()].erase(c);
-      delete c;
+    if (c == 0) return;
+    std::unique_lock<std::mutex> guard(pipelock, std::defer_lock);
+    if (updating) guard.lock();
+    
+    /* workers may be walking the family lists, so nothing leaves them
+     * until the pass is over */
+    if (rightnow == false || updating) {
+      if (c->removing) return;
+      c->removing = true;
+      removedcom->push_back(c);
+    } else {
+      unlink(c);
+      addedcom->erase(std::remove(addedcom->begin(), addedcom->end(), c), addedcom->end());
+      forget(c);
+      component::base::dispose(c);
+    }
+  }
+  
+  void engine::sleep(component::base * c, timediff seconds) {
+    if (c == 0 || wheel == 0 || c->pooled) return;
+    std::unique_lock<std::mutex> guard(pipelock, std::defer_lock);
+    if (updating) guard.lock();
+    if (c->alarm != 0) {
+      wheel->cancel(c->alarm);
+      c->alarm = 0;
+    }
+    if (seconds >= 0) {
+      c->alarm = wheel->add(c->timers, seconds, [c] {
+        c->alarm = 0;
+        wake(c);
+      });
+    }
+    c->asleep = true;
+    if (!c->restless) {
+      c->restless = true;
+      restless->push_back(c);
+    }
+  }
+  
+  void engine::wake(component::base * c) {
+    if (c == 0 || wheel == 0 || c->pooled) return;
+    std::unique_lock<std::mutex> guard(pipelock, std::defer_lock);
+    if (updating) guard.lock();
+    if (!c->asleep) return;
+    if (c->alarm != 0) {
+      wheel->cancel(c->alarm);
+      c->alarm = 0;
+    }
+    c->asleep = false;
+    if (!c->restless) {
+      c->restless = true;
+      restless->push_back(c);
+    }
+  }
+  
+  void engine::schedule(component::base * c, timediff seconds, const std::function<void()> & fire) {
+    if (c == 0 || wheel == 0 || c->pooled) return;
+    std::unique_lock<std::mutex> guard(pipelock, std::defer_lock);
+    if (updating) guard.lock();
+    wheel->add(c->timers, seconds, fire);
+  }
+  
+  void engine::settle() {
+    for (size_t i = 0; i < restless->size(); i++) {
+      component::base * c = (*restless)[i];
+      c->restless = false;
+      
+      /* not in the pipeline yet, add() puts it in the right list */
+      if (c->famslot < 0 || c->removing || c->asleep == c->parked) continue;
+      unlink(c);
+      pipeline & p = (*components)[c->famslot];
+      std::vector<component::base *> & coms = c->asleep ? p.sleeping : p.coms;
+      c->parked = c->asleep;
+      c->comslot = coms.size();
+      coms.push_back(c);
+    }
+    restless->clear();
+  }
+  
+  void engine::retire(component::base * c) {
+    unlink(c);
+    forget(c);
+    c->asleep = false;
+    c->parked = false;
+  }
+  
+  void engine::forget(component::base * c) {
+    if (wheel != 0) wheel->clear(c->timers);
+    c->alarm = 0;
+    if (c->restless) {
+      restless->erase(std::remove(restless->begin(), restless->end(), c), restless->end());
+      c->restless = false;
     }
   }
   
   void engine::destroy(object::id oid) {
-    destroyedobj->insert(oid);
+    std::unique_lock<std::mutex> guard(pipelock, std::defer_lock);
+    if (updating) guard.lock();
+    destroyedobj->push_back(oid);
+  }
+  
+  void engine::update(int slot, timediff delta, int begin) {
+    double start = profiling ? profiler::now() : 0;
+    size_t count = (*components)[slot].coms.size();
+    
+    /* parallel families are split in a few chunks per thread. the list does
+     * not change meanwhile, additions wait for the end of the update phase */
+    if (updating && (*components)[slot].parallel && count > 64) {
+      struct chunks {
+        int slot;
+        timediff delta;
+        int begin;
+        size_t size;
+        threadpool::batch done;
+      } job;
+      job.slot = slot;
+      job.delta = delta;
+      job.begin = begin;
+      job.size = std::max<size_t>(64, count / ((workers->size() + 1) * 4) + 1);
+      for (size_t first = 0; first < count; first += job.size) {
+        chunks * j = &job;
+        workers->push(job.done, [j, first] {
+          update(j->slot, j->delta, j->begin, first, first + j->size);
+        });
+      }
+      workers->wait(job.done);
+    } else {
+      /* components added meanwhile are updated too */
+      update(slot, delta, begin, 0, (size_t)-1);
+    }
+    
+    if (profiling) (*components)[slot].timing->add(profiler::now() - start);
+  }
+  
+  void engine::update(int slot, timediff delta, int begin, size_t first, size_t last) {
+    /* a new family may move the lists around, do not hold on to them */
+    std::vector<pipeline> & families = *components;
+    if (!profiling) {
+      for (size_t i = first; i < last && i < families[slot].coms.size(); i++) {
+        families[slot].coms[i]->update(delta, begin);
+      }
+      return;
+    }
+    
+    /* time every component, adding up runs of the same type */
+    int type = -1;
+    double spent = 0, mark = profiler::now();
+    for (size_t i = first; i < last && i < families[slot].coms.size(); i++) {
+      component::base * c = families[slot].coms[i];
+      c->update(delta, begin);
+      double now = profiler::now();
+      if (c->typeslot != type) {
+        if (type >= 0) (*typesections)[type]->add(spent);
+        type = c->typeslot;
+        spent = 0;
+      }
+      spent += now - mark;
+      mark = now;
+    }
+    if (type >= 0) (*typesections)[type]->add(spent);
+  }
+  
+  double engine::lap(profiler::section * s, double mark) {
+    double now = profiler::now();
+    s->add(now - mark);
+    return now;
+  }
+  
+  std::vector<profiler::stat> engine::stats() {
+    if (prof == 0) return std::vector<profiler::stat>();
+    return prof->stats();
+  }
+  
+  profiler::stat engine::stats(const std::string & section) {
+    if (prof == 0) {
+      profiler::stat st;
+      st.name = section;
+      st.min = st.avg = st.p99 = st.last = 0;
+      st.samples = 0;
+      return st;
+    }
+    return prof->stats(section);
   }
   
   void engine::init(bool force) {
@@ -81,41 +381,73 @@ namespace gear2d {
     //flags |= SDL_INIT_EVENTTHREAD;
 #endif
 
+    // headless runs only need the timer
+    if (isheadless) flags = SDL_INIT_TIMER;
+
     SDL_Init(flags);
-    SDL_AddEventWatch((SDL_EventFilter)quitwatcher, 0);
+    if (!isheadless) SDL_AddEventWatch((SDL_EventFilter)quitwatcher, 0);
     config = new std::map<std::string, std::string>;
     
-    // erase all the components
+    // erase all the components, sleeping ones too
     if (components != 0) {
-      for (map<component::family, std::set<component::base *> >::iterator i = components->begin();
-         i != components->end();
-         i++)
-      {
-        std::set<component::base *> & com = i->second;
-        while (!com.empty()) {
-          component::base * c = *(com.begin());
-          if (c != 0) delete c;
-          com.erase(c);
+      for (size_t i = 0; i < components->size(); i++) {
+        std::vector<component::base *> & com = (*components)[i].coms;
+        for (size_t j = 0; j < com.size(); j++) {
+          if (com[j] != 0) component::base::dispose(com[j]);
+        }
+        std::vector<component::base *> & sleeping = (*components)[i].sleeping;
+        for (size_t j = 0; j < sleeping.size(); j++) {
+          if (sleeping[j] != 0) component::base::dispose(sleeping[j]);
         }
       }
     }
     delete components;
-    components = new std::map<component::family, std::set<component::base *> >;
+    components = new std::vector<pipeline>;
+    
+    if (famslots != 0) delete famslots;
+    famslots = new std::unordered_map<symbol, int>;
+    
+    if (schedules != 0) delete [] schedules;
+    schedules = new plan[2];
+    rescheduling = true;
     
     if (removedcom != 0) delete removedcom;
-    removedcom = new std::set<component::base *>;
+    removedcom = new std::vector<component::base *>;
     
     if (destroyedobj != 0) delete destroyedobj;
-    destroyedobj = new std::set<object::id>;
+    destroyedobj = new std::vector<object::id>;
+    
+    if (addedcom != 0) delete addedcom;
+    addedcom = new std::vector<component::base *>;
+    
+    if (independents != 0) delete independents;
+    independents = new std::set<component::family>;
+    
+    if (variables != 0) delete variables;
+    variables = new std::set<component::family>;
+    
+    if (wheel != 0) delete wheel;
+    wheel = new timerwheel;
+    
+    if (restless != 0) delete restless;
+    restless = new std::vector<component::base *>;
+    updating = false;
+    deferring = false;
 
     if (ofactory != 0) delete ofactory;
     if (cfactory != 0) delete cfactory;
     cfactory = new component::factory;
     ofactory = new object::factory(*cfactory);
+    parameterbase::discard();
+    if (pace == 0) pace = new pacer;
     initialized = true;
     started = false;
   }
   
+  void engine::headless(bool enable) {
+    isheadless = enable;
+  }
+  
   void engine::next(std::string configfile) {
     *nextscene = configfile;
   }
@@ -147,8 +479,90 @@ namespace gear2d {
     cfactory->compath = compath;
     config->erase("compath");
     
+    /* worker threads. the count includes the main thread, 0 means one per core */
+    int threads = eval<int>((*config)["threads"], 1);
+    if (threads == 0) threads = SDL_GetCPUCount();
+    if (workers != 0 && workers->size() != threads - 1) {
+      delete workers;
+      workers = 0;
+    }
+    if (workers == 0 && threads > 1) {
+      trace.i("Updating independent families with", threads - 1, "worker threads");
+      workers = new threadpool(threads - 1);
+    }
+    config->erase("threads");
+    
+    split(*independents, (*config)["independent"], ' ');
+    config->erase("independent");
+    
+    /* fixed timestep, in seconds. 0 passes the frame delta along */
+    timestep = eval<timediff>((*config)["timestep"], 0);
+    maxsteps = eval<int>((*config)["maxsteps"], 5);
+    if (maxsteps < 1) maxsteps = 1;
+    accumulator = 0;
+    interpolation = 0;
+    split(*variables, (*config)["variable"], ' ');
+    config->erase("timestep");
+    config->erase("maxsteps");
+    config->erase("variable");
+    
+    /* target frames per second, 0 to run as fast as possible */
+    pace->rate(eval<int>((*config)["framerate"], 90));
+    config->erase("framerate");
+    
+    /* frame profiler. statistics survive scene switches and go to profilecsv at shutdown */
+    profiling = eval<bool>((*config)["profile"], false);
+    if (profiling && prof == 0) {
+      prof = new profiler;
+      profilecsv = new std::string;
+      typeslots = new std::unordered_map<symbol, int>;
+      typesections = new std::vector<profiler::section *>;
+      phases.timers = prof->get("phase:timers");
+      phases.destroy = prof->get("phase:destroy");
+      phases.remove = prof->get("phase:remove");
+      phases.update = prof->get("phase:update");
+      phases.notify = prof->get("phase:notify");
+      phases.commit = prof->get("phase:commit");
+      phases.scene = prof->get("phase:scene");
+      phases.delay = prof->get("phase:delay");
+      phases.frame = prof->get("frame");
+    }
+    if (profiling && (*config)["profilecsv"] != "") *profilecsv = (*config)["profilecsv"];
+    config->erase("profile");
+    config->erase("profilecsv");
+    
+    /* families listed per phase are updated in that order, before the unlisted ones */
+    const char * phasekeys[] = { "schedule.pre", "schedule.update", "schedule.post" };
+    for (int phase = 0; phase < 3; phase++) {
+      std::vector<component::family> listed;
+      split(listed, (*config)[phasekeys[phase]], ' ');
+      for (size_t i = 0; i < listed.size(); i++) {
+        pipeline & p = (*components)[familyslot(listed[i])];
+        if (p.declared) {
+          trace.w("Family", listed[i], "is scheduled more than once, keeping its first place");
+          continue;
+        }
+        p.declared = true;
+        p.phase = phase;
+      }
+      config->erase(phasekeys[phase]);
+    }
+    
+    /* deferred notifications reach listeners once per phase, not once per write */
+    std::string notify = (*config)["notify"];
+    if (notify != "" && notify != "immediate" && notify != "deferred") {
+      trace.w("Unknown notify mode", notify, "notifying immediately");
+    }
+    deferring = (notify == "deferred");
+    config->erase("notify");
+    
+    /* travel the compath looking for family/component, remembering
+     * what was found for the next run. workers help if there are any */
+    std::string manifest = (*config)["commanifest"];
+    if (manifest != "" && compath != "") cfactory->scan(manifest, workers);
+    config->erase("commanifest");
+    
     /* pre-load some of the components */
-    /* TODO: travel the compath looking for family/component */
     std::vector<std::string> comlist;
     if ((*config)["compreload"].size() != 0) {
       split(comlist, (*config)["compreload"], ' ');
@@ -178,77 +592,204 @@ namespace gear2d {
     }
     if (nextscene) delete nextscene;
     nextscene = new std::string("");
+    started = true;
   }
   
-  int engine::run() {
-    // make sure we init
-    init();
-    modinfo("engine-run");
-    int begin = 0, end = 0, dt = 0;
-    started = true;
-    FPSmanager fps;
-    SDL_initFramerate(&fps);
-    SDL_setFramerate(&fps, 90);
-    while (started) {
-      //trace("Loop.");
-      dt = end - begin;
-      begin = SDL_GetTicks();
-      timediff delta = dt/1000.0f;
-      SDL_framerateDelay(&fps);
-      
-      SDL_PumpEvents();
-      
-      for (std::set<object::id>::iterator i = destroyedobj->begin(); i != destroyedobj->end(); i++) {
-        /* this will push object's components to removedcom, hopefully. */
-        delete (*i);
-      }
+  void engine::collect() {
+    double mark = profiling ? profiler::now() : 0;
+    
+    for (size_t i = 0; i < destroyedobj->size(); i++) {
+      object::id o = (*destroyedobj)[i];
       
-      destroyedobj->clear();
+      /* pooled objects keep their components for the next build */
+      if (o->ofactory != 0 && o->ofactory->recycle(o)) continue;
       
-      /* first remove components from the running pipeline */
-      for (std::set<component::base *>::iterator i = removedcom->begin(); i != removedcom->end(); i++) {
-        component::type f = (*i)->family();
-        (*components)[f].erase((*i));
-
-        if (*i != 0) delete (*i);
-        
-        // do not manage empty lists
-        if ((*components)[f].size() == 0)
-          components->erase(f);
+      /* this will push object's components to removedcom, hopefully. */
+      delete o;
+    }
+    
+    destroyedobj->clear();
+    if (profiling) mark = lap(phases.destroy, mark);
+    
+    /* first remove components from the running pipeline */
+    for (size_t i = 0; i < removedcom->size(); i++) {
+      component::base * c = (*removedcom)[i];
+      unlink(c);
+      forget(c);
+      component::base::dispose(c);
+    }
+    
+    // clear the removed list
+    removedcom->clear();
+    if (profiling) lap(phases.remove, mark);
+  }
+  
+  void engine::pass(timediff delta, int begin, bool variable) {
+    double mark = profiling ? profiler::now() : 0;
+    
+    settle();
+    if (rescheduling) reschedule();
+    const plan & s = schedules[variable ? 1 : 0];
+    
+    /* now update pipeline accordingly, phase after phase. independent
+     * families go to the workers while the others are updated here, in
+     * order. without a fixed timestep every family is variable */
+    if (deferring) parameterbase::defer(true);
+    if (workers == 0) {
+      size_t first = 0;
+      for (int phase = 0; phase < 3; phase++) {
+        for (size_t f = first; f < s.ends[phase]; f++) update(s.slots[f], delta, begin);
+        sync();
+        first = s.ends[phase];
       }
-      
-      // clear the removed list
-      removedcom->clear();
-      
-      /* now update pipeline accordingly */
-      std::map<component::family, std::set<component::base *> >::iterator comtpit;
-      int i = 0;
-      for (comtpit = components->begin(); comtpit != components->end(); comtpit++) {
-        component::family f = comtpit->first;
-        std::set<component::base *> & list = comtpit->second;
-        for (std::set<component::base*>::iterator comit = list.begin(); comit != list.end(); comit++) {
-          i++;
-          (*comit)->update(delta, begin);
+    } else {
+      updating = true;
+      size_t first = 0;
+      for (int phase = 0; phase < 3; phase++) {
+        threadpool::batch done;
+        for (size_t f = first; f < s.ends[phase]; f++) {
+          int slot = s.slots[f];
+          if ((*components)[slot].independent)
+            workers->push(done, [slot, delta, begin] { update(slot, delta, begin); });
+        }
+        for (size_t f = first; f < s.ends[phase]; f++) {
+          if (!(*components)[s.slots[f]].independent) update(s.slots[f], delta, begin);
         }
+        
+        /* a phase is done before the next one begins */
+        workers->wait(done);
+        sync();
+        first = s.ends[phase];
       }
+      updating = false;
       
-      //trace("I have updated", i, "components");
-      /* no components, quit the engine */
-      if (components->empty()) started = false;
-      
-      /* shall load next scene */
-      if (*nextscene != "") {
-        load(nextscene->c_str());
-        started = true;
+      for (size_t i = 0; i < addedcom->size(); i++) add((*addedcom)[i]);
+      addedcom->clear();
+    }
+    if (deferring) parameterbase::defer(false);
+    if (profiling) mark = lap(phases.update, mark);
+    
+    /* double-buffered parameters show what this pass wrote */
+    parameterbase::commit();
+    if (profiling) lap(phases.commit, mark);
+  }
+  
+  void engine::sync() {
+    if (!deferring) return;
+    double mark = profiling ? profiler::now() : 0;
+    parameterbase::deliver();
+    if (profiling) lap(phases.notify, mark);
+  }
+  
+  bool engine::step(timediff delta) {
+    int begin = SDL_GetTicks();
+    frames++;
+    
+    /* loading a scene may turn profiling on or off, stick to how we began */
+    bool profiled = profiling;
+    double start = profiled ? profiler::now() : 0;
+    
+    if (!isheadless) SDL_PumpEvents();
+    
+    /* timers fire before anything else, so whoever they wake gets updated */
+    double mark = profiled ? profiler::now() : 0;
+    wheel->advance(delta);
+    if (profiled) lap(phases.timers, mark);
+    
+    if (timestep <= 0) {
+      collect();
+      pass(delta, begin, true);
+    } else {
+      /* run as many fixed steps as the elapsed time asks for, but give up
+       * on catching up past maxsteps so a slow frame can't snowball */
+      accumulator += delta;
+      if (accumulator > maxsteps * timestep) accumulator = maxsteps * timestep;
+      while (accumulator >= timestep) {
+        collect();
+        pass(timestep, begin, false);
+        accumulator -= timestep;
       }
+      interpolation = accumulator / timestep;
       
-      end = SDL_GetTicks();
+      /* variable families, like renderers, run once per frame */
+      collect();
+      pass(delta, begin, true);
+    }
+    
+    /* no components, quit the engine */
+    size_t running = 0;
+    for (size_t f = 0; f < components->size(); f++) running += (*components)[f].coms.size() + (*components)[f].sleeping.size();
+    if (running == 0) started = false;
+    
+    /* shall load next scene */
+    if (*nextscene != "") {
+      mark = profiled ? profiler::now() : 0;
+      load(nextscene->c_str());
+      if (profiled) lap(phases.scene, mark);
+    }
+    
+    if (profiled) {
+      phases.frame->add(profiler::now() - start);
+      prof->frame();
+    }
+    
+    return started;
+  }
+  
+  timediff engine::alpha() {
+    return interpolation;
+  }
+  
+  unsigned long engine::missed() {
+    return (pace == 0) ? 0 : pace->missed();
+  }
+  
+  int engine::run() {
+    // make sure we init
+    init();
+    modinfo("engine-run");
+    started = true;
+    
+    /* delta is measured from one frame start to the next, delay included */
+    long long last = pacer::now();
+    while (started) {
+      timediff waited = isheadless ? 0 : pace->wait();
+      if (profiling) phases.delay->add(waited);
+      long long now = pacer::now();
+      timediff delta = (now - last) / 1e9;
+      last = now;
+      step(delta);
     }
     
+    shutdown();
+    return 0;
+  }
+  
+  void engine::shutdown() {
+    if (prof != 0) {
+      modinfo("engine");
+      if (*profilecsv != "" && !prof->dump(*profilecsv)) trace.w("Could not write profiler statistics to", *profilecsv);
+      delete prof;
+      delete profilecsv;
+      delete typeslots;
+      delete typesections;
+      prof = 0;
+      profilecsv = 0;
+      typeslots = 0;
+      typesections = 0;
+      profiling = false;
+    }
+    
+    delete workers;
+    delete pace;
     delete ofactory;
     delete cfactory;
+    workers = 0;
+    pace = 0;
+    ofactory = 0;
+    cfactory = 0;
+    initialized = false;
     SDL_Quit();
-    return 0;
   }
 
   int engine::quit() {
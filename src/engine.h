@@ -3,9 +3,15 @@
 
 #include "definitions.h"
 #include "object.h"
+#include "profiler.h"
+#include "symbol.h"
 
 #include <list>
 #include <map>
+#include <unordered_map>
+#include <vector>
+#include <mutex>
+#include <functional>
 
 /**
  * @file engine.h
@@ -16,6 +22,9 @@
 
 namespace gear2d {
   namespace component { class base; class factory; }
+  class threadpool;
+  class pacer;
+  class timerwheel;
   
   /**
    * @brief Gear2D main engine that binds everything.
@@ -25,6 +34,9 @@ namespace gear2d {
    * it commands registering and loading of components and
    * objects */
   class g2dapi engine {
+    friend class component::base;
+    friend class object::factory;
+    
     public:
       /**
        * @brief Returns the version of the engine.
@@ -74,12 +86,62 @@ namespace gear2d {
        * @param c Component pointer to be deleted
        * @param rightnow Remove this component right now. This might break if the component is being updated.
        * 
-       * This removes the component of the update pipeline. */
+       * This removes the component of the update pipeline. While worker
+       * threads are updating, the removal waits for the end of the pass
+       * even if @p rightnow is true. */
       static void remove(component::base * c, bool rightnow = false);
       
       /**
        * @brief Destroy/delete an game object and its components. */
       static void destroy(object::id oid);
+      
+      /**
+       * @brief Run the engine without a video subsystem.
+       * @param enable true to run headless, false to run with video
+       * 
+       * A headless engine does not initialize video nor pump events
+       * and does not wait between frames. Call it before init() or
+       * load(), it is kept across scene switches. */
+      static void headless(bool enable);
+      
+      /**
+       * @brief Advance the engine exactly one frame.
+       * @param dt Time difference, in seconds, to be passed to the components
+       * @return false when there are no components left or quit() was called
+       * 
+       * Destroys and removes what was marked in the last frame,
+       * updates every component once and switches scenes if asked to.
+       * Use this to drive the engine from your own loop, and call
+       * shutdown() when done. */
+      static bool step(timediff dt);
+       
+       /**
+        * @brief Interpolation factor between the last two fixed steps.
+        * @return How far, from 0 to 1, the frame is between the last fixed
+        * step and the next one
+        * 
+        * With a fixed timestep (@p timestep:), simulation advances in fixed
+        * steps while frames take whatever time they take. Families updated
+        * once per frame (@p variable:), like renderers, use this to blend
+        * between the previous and the current simulated state. Always 0
+        * without a fixed timestep. */
+       static timediff alpha();
+       
+       /**
+        * @brief Number of frames that missed their deadline.
+        * 
+        * Counts the frames run() could not fit in the period of the
+        * scene @p framerate:. */
+       static unsigned long missed();
+       
+       /**
+        * @brief Number of the running frame.
+        * 
+        * Counts up by one at the start of each step(), scene switches
+        * included. Setup happens in frame 0. Parameters remember the
+        * frame they were last written in, see link::changed_since().
+        * Signed, so that frame() - 1 is still before setup. */
+       static long frame() { return frames; }
        
        /**
         * @brief Run the engine.
@@ -88,6 +150,27 @@ namespace gear2d {
         * no game components to run */
        static int run();
        
+       /**
+        * @brief Release the factories and the SDL subsystems.
+        * 
+        * run() calls this when leaving the main loop. */
+       static void shutdown();
+       
+       /**
+        * @brief Frame timing statistics.
+        * @return Rolling statistics of every timed section
+        * 
+        * Timing is only collected when the scene sets @p profile:. Sections
+        * are named family:<family>, type:<type>, phase:<phase> for the destroy,
+        * remove, update, scene and delay phases, and frame for the whole step. */
+       static std::vector<profiler::stat> stats();
+       
+       /**
+        * @brief Frame timing statistics of a single section.
+        * @param section Name of the section, as in stats()
+        * @return Rolling statistics of the section, zeroed if never timed */
+       static profiler::stat stats(const std::string & section);
+       
        /**
         * @brief Quits the engine.
         * 
@@ -98,13 +181,119 @@ namespace gear2d {
     private:
       engine() { };
       
+      /* take a component off its family list, swapping the last one in its place */
+      static void unlink(component::base * c);
+      
+      /* update every component of the family in slot */
+      static void update(int slot, timediff delta, int begin);
+      
+      /* update the components of the family in slot from first to last */
+      static void update(int slot, timediff delta, int begin, size_t first, size_t last);
+      
+      /* destroy marked objects and remove marked components */
+      static void collect();
+      
+      /* update the variable families, or the fixed ones */
+      static void pass(timediff delta, int begin, bool variable);
+      
+      /* slot of a family, making an empty pipeline for it if needed */
+      static int familyslot(const symbol & f);
+      
+      /* lay the families out in the fixed and variable schedules */
+      static void reschedule();
+      
+      /* make a component sleep, for seconds or, if negative, until woken */
+      static void sleep(component::base * c, timediff seconds);
+      
+      /* wake a sleeping component */
+      static void wake(component::base * c);
+      
+      /* call fire after some seconds, unless c is removed before */
+      static void schedule(component::base * c, timediff seconds, const std::function<void()> & fire);
+      
+      /* move components that fell asleep or woke up between their lists */
+      static void settle();
+      
+      /* drop the timers and pending requests of a component about to be deleted */
+      static void forget(component::base * c);
+      
+      /* take the component of a pooled object out of the pipeline, keeping it */
+      static void retire(component::base * c);
+      
+      /* deliver notifications deferred while a phase ran */
+      static void sync();
+      
+      /* add the time since mark to a section, returning the new mark */
+      static double lap(profiler::section * s, double mark);
+      
     private:
+      /* running components of a family, kept contiguous */
+      struct pipeline {
+        component::family family;
+        std::vector<component::base *> coms;
+        
+        /* sleeping components, out of the way of updates */
+        std::vector<component::base *> sleeping;
+        
+        /* updated by the workers, alongside the other families */
+        bool independent;
+        
+        /* split in chunks updated by the workers */
+        bool parallel;
+        
+        /* updated once per frame instead of once per fixed step */
+        bool variable;
+        
+        /* listed by the scene in one of the phases */
+        bool declared;
+        
+        /* phase it is updated in: 0 pre-update, 1 update, 2 post-update */
+        int phase;
+        
+        /* traits were taken from its first component */
+        bool traits;
+        
+        /* profiler section, null when not profiling */
+        profiler::section * timing;
+      };
+      
+      /* family slots in update order. each phase ends before the next begins */
+      struct plan {
+        std::vector<int> slots;
+        
+        /* end of each phase in slots */
+        size_t ends[3];
+      };
+      
+      /* profiler sections of the frame phases */
+      struct phasetiming {
+        profiler::section * timers;
+        profiler::section * destroy;
+        profiler::section * remove;
+        profiler::section * update;
+        profiler::section * notify;
+        profiler::section * commit;
+        profiler::section * scene;
+        profiler::section * delay;
+        profiler::section * frame;
+      };
+
+      
       
       /* config map */
       static std::map<std::string, std::string> * config;
       
-      /* running component-type map */
-      static std::map<component::family, std::set<component::base *> > * components;
+      /* running families, indexed by the slot cached in each component */
+      static std::vector<pipeline> * components;
+      
+      /* family to slot in components */
+      static std::unordered_map<symbol, int> * famslots;
+      
+      /* update order of the fixed (0) and variable (1) passes */
+      static plan * schedules;
+      
+      /* marks that families were added since the schedules were laid out */
+      static bool rescheduling;
       
       /* component factory */
       static component::factory * cfactory;
@@ -118,15 +307,79 @@ namespace gear2d {
       /* marks if the engine was even started */
       static bool started;
       
+      /* marks if the engine runs without video and frame delay */
+      static bool isheadless;
+      
       /* components to be removed */
-      static std::set<component::base *> * removedcom;
+      static std::vector<component::base *> * removedcom;
       
       /* objects to be destroyed */
-      static std::set<object::id> * destroyedobj;
+      static std::vector<object::id> * destroyedobj;
       
       /* scene file to switch */
       static std::string * nextscene;
       
+      /* worker threads, null when running single-threaded */
+      static threadpool * workers;
+      
+      /* families the scene declared independent */
+      static std::set<component::family> * independents;
+      
+      /* components added while updating, joining the pipeline at the end of it */
+      static std::vector<component::base *> * addedcom;
+      
+      /* marks that families are being updated by the workers */
+      static bool updating;
+      
+      /* guards the pending lists while updating */
+      static std::mutex pipelock;
+      
+      /* frame profiler, kept from the first profiled scene on */
+      static profiler * prof;
+      
+      /* marks that the running scene is being profiled */
+      static bool profiling;
+      
+      /* where to dump the profiler statistics at shutdown */
+      static std::string * profilecsv;
+      
+      /* cached phase sections */
+      static phasetiming phases;
+      
+      /* component type to index in typesections, cached in the components */
+      static std::unordered_map<symbol, int> * typeslots;
+      static std::vector<profiler::section *> * typesections;
+      
+      /* fixed timestep, 0 when frames pass their own delta */
+      static timediff timestep;
+      
+      /* most fixed steps run in a single frame */
+      static int maxsteps;
+      
+      /* time not yet simulated in fixed steps */
+      static timediff accumulator;
+      
+      /* accumulator over timestep after the last fixed step */
+      static timediff interpolation;
+      
+      /* families updated once per frame when using a fixed timestep */
+      static std::set<component::family> * variables;
+      
+      /* holds run() to the scene framerate */
+      static pacer * pace;
+      
+      /* timers of the components, sleeping ones included */
+      static timerwheel * wheel;
+      
+      /* components that fell asleep or woke up since the last settle */
+      static std::vector<component::base *> * restless;
+      
+      /* parameter notifications wait for the end of each phase */
+      static bool deferring;
+      
+      /* frames stepped since the engine began */
+      static long frames;
+      
   };
 
 }
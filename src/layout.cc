@@ -0,0 +1,67 @@
+#include "layout.h"
+
+namespace gear2d {
+  layout::table::table(int symbols, int slots)
+  : symbols(symbols)
+  , index(new std::atomic<int>[symbols])
+  , slots(slots)
+  , names(new symbol[slots]) {
+    for (int i = 0; i < symbols; i++) index[i].store(-1, std::memory_order_relaxed);
+  }
+
+  layout::table::~table() {
+    delete [] index;
+    delete [] names;
+  }
+
+  layout::layout()
+  : count(0) {
+    current.store(new table(64, 16), std::memory_order_release);
+  }
+
+  layout::~layout() {
+    delete current.load();
+    for (size_t i = 0; i < retired.size(); i++) delete retired[i];
+  }
+
+  int layout::add(const symbol & pid) {
+    int slot = find(pid);
+    if (slot >= 0) return slot;
+
+    std::lock_guard<std::mutex> guard(lock);
+    table * t = current.load(std::memory_order_acquire);
+    int i = pid.id();
+    if (i < t->symbols && t->index[i].load(std::memory_order_relaxed) >= 0) return t->index[i].load(std::memory_order_relaxed);
+
+    /* out of room, move to a bigger table */
+    slot = count.load(std::memory_order_relaxed);
+    if (i >= t->symbols || slot >= t->slots) {
+      int symbols = t->symbols, slots = t->slots;
+      while (symbols <= i) symbols *= 2;
+      if (slot >= slots) slots *= 2;
+      table * bigger = new table(symbols, slots);
+      for (int s = 0; s < t->symbols; s++) bigger->index[s].store(t->index[s].load(std::memory_order_relaxed), std::memory_order_relaxed);
+      for (int s = 0; s < slot; s++) bigger->names[s] = t->names[s];
+      current.store(bigger, std::memory_order_release);
+      retired.push_back(t);
+      t = bigger;
+    }
+
+    /* the name goes first, whoever finds the slot may ask for it */
+    t->names[slot] = pid;
+    t->index[i].store(slot, std::memory_order_release);
+    count.store(slot + 1, std::memory_order_release);
+    return slot;
+  }
+
+  int layout::size() const {
+    return count.load(std::memory_order_acquire);
+  }
+
+  symbol layout::name(int slot) const {
+    /* count first: any table published after it has those names */
+    int n = size();
+    const table * t = current.load(std::memory_order_acquire);
+    return (slot >= 0 && slot < n) ? t->names[slot] : symbol();
+  }
+}
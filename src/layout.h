@@ -0,0 +1,77 @@
+#ifndef gear2d_layout_h
+#define gear2d_layout_h
+
+#include "definitions.h"
+#include "symbol.h"
+
+#include <vector>
+#include <atomic>
+#include <mutex>
+
+/**
+ * @file layout.h
+ * @brief Parameter layouts shared by objects of the same type.
+ *
+ * Objects of a type end up with the same parameters, so instead of
+ * each one keeping its own table of ids, they share a layout that
+ * tells in which slot of their flat parameter array each id is. */
+
+namespace gear2d {
+  /**
+   * @brief Maps parameter ids to slots.
+   *
+   * A layout only grows: an id keeps its slot for the life of the
+   * layout. Looking an id up is indexing an array by its symbol, and
+   * never adds anything. Adding an id is safe while other threads
+   * look ids up. */
+  class g2dapi layout {
+    public:
+      layout();
+      ~layout();
+
+      /**
+       * @brief Slot of an id.
+       * @return The slot, or -1 if the id is not in the layout */
+      int find(const symbol & pid) const {
+        const table * t = current.load(std::memory_order_acquire);
+        int i = pid.id();
+        return (i < t->symbols) ? t->index[i].load(std::memory_order_acquire) : -1;
+      }
+
+      /**
+       * @brief Slot of an id, giving it the next free one if needed.
+       * @return The slot */
+      int add(const symbol & pid);
+
+      /** @brief Number of slots. */
+      int size() const;
+
+      /** @brief Id kept in a slot. */
+      symbol name(int slot) const;
+
+    private:
+      /* entries are only ever set once, so readers need no lock. a full
+       * table is copied into one twice as big */
+      struct table {
+        table(int symbols, int slots);
+        ~table();
+
+        /* symbol id to slot, -1 when absent */
+        int symbols;
+        std::atomic<int> * index;
+
+        /* slot to symbol */
+        int slots;
+        symbol * names;
+      };
+
+      std::atomic<table *> current;
+      std::atomic<int> count;
+
+      /* tables replaced by a bigger one, kept for readers still on them */
+      std::vector<table *> retired;
+      std::mutex lock;
+  };
+}
+
+#endif
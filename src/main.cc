@@ -1,7 +1,11 @@
 #include "gear2d.h"
 #include "logtrace.h"
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <chrono>
 
 #ifdef __ANDROID__
 #define main SDL_main
@@ -15,7 +19,10 @@ void help() {
          "\t-h        : Prints this help\n"
          "\t-l<level> : Verbosity level to the logging messages. 0 is the lowest,\n"
          "\t            4 is the highest.\n"
-         "\t-f<filter>: Filter string to apply to the logging messages \n");
+         "\t-f<filter>: Filter string to apply to the logging messages \n"
+         "\t-H        : Headless run, without video and frame delay\n"
+         "\t-b<frames>: Benchmark. Run <frames> frames headless as fast as\n"
+         "\t            possible and report frames per second\n");
 }
 
 #ifdef __cplusplus
@@ -24,6 +31,7 @@ extern "C"
 int main(int argc, char ** argv, char ** env) {
   char * arg = 0;
   const char * scene = "gear2d.yaml";
+  int benchframes = 0;
   while (argc > 1) {
     arg = argv[argc-1];
     if (strlen(arg) == 2 && arg[0] == '-' && arg[1] == 'v') {
@@ -60,6 +68,26 @@ int main(int argc, char ** argv, char ** env) {
           break;
         }
         
+        case 'H': {
+          gear2d::engine::headless(true);
+          break;
+        }
+        
+        case 'b': {
+          /* a bad count would fall through to a headless run that never ends */
+          char * end = 0;
+          errno = 0;
+          long frames = strtol(arg+2, &end, 10);
+          if (end == arg+2 || *end != 0 || errno == ERANGE || frames <= 0 || frames > INT_MAX) {
+            printf("Invalid frame count %s, expected a positive number.\n", arg+2);
+            help();
+            exit(1);
+          }
+          benchframes = (int)frames;
+          gear2d::engine::headless(true);
+          break;
+        }
+        
         default: {
           printf("Unknown argument %s.\n", arg);
           help();
@@ -77,6 +105,22 @@ int main(int argc, char ** argv, char ** env) {
 #endif
 
   gear2d::engine::load(scene);
+  
+  // benchmark: fixed simulated delta so that every run does the same work
+  if (benchframes > 0) {
+    typedef std::chrono::steady_clock clock;
+    int frames = 0;
+    clock::time_point start = clock::now();
+    while (frames < benchframes) {
+      frames++;
+      if (!gear2d::engine::step(1/60.0f)) break;
+    }
+    double elapsed = std::chrono::duration<double>(clock::now() - start).count();
+    printf("%d frames in %.3f s: %.1f frames/s\n", frames, elapsed, elapsed > 0 ? frames / elapsed : 0.0);
+    gear2d::engine::shutdown();
+    exit(0);
+  }
+  
   int running = gear2d::engine::run();
   exit(running);
 }
@@ -9,12 +9,23 @@
 #include <algorithm>
 
 namespace gear2d {
-  object::object(object::signature & sig)
-   : destroyed(false)
+  object::object(object::signature & sig, layout * shape, archetype * store, const std::vector<symbol> * buffered)
+   : ofactory(0)
+   , print(0)
+   , comslots(families().size(), (component::base *) 0)
+   , shape(shape)
+   , slots(shape->size(), (parameterbase::value) 0)
+   , store(store)
+   , row(store != 0 ? store->row() : -1)
+   , buffered(buffered)
+   , destroyed(false)
+   , printed(false)
    , sig(sig) {
   }
   
   object::~object() {
+    if (ofactory != 0) ofactory->loadedobjs[sig["name"]].remove(this);
+    
     // delete all components
     for (componentcontainer::iterator i = components.begin(); i != components.end(); i++) {
       component::base * c = i->second;
@@ -25,15 +36,17 @@ namespace gear2d {
     }
     
     // delete all properties
-    for (parameterbase::table::iterator i = parameters.begin(); i != parameters.end(); i++) {
-      parameterbase * p = i->second;
+    for (size_t i = 0; i < slots.size(); i++) {
+      parameterbase * p = slots[i];
       if (p != 0) {
-        parameters[p->pid] = 0;
+        slots[i] = 0;
         if (p->dodestroy)  {
           delete p;
         }
       }
     }
+    
+    if (store != 0) store->release(row);
   }
   
   object::id object::oid() { return this; }
@@ -46,94 +59,127 @@ namespace gear2d {
     trace("Attaching", newc->family(), newc->type());
     
     /* sees that dependencies are met */
-    std::string depends = newc->depends();
-    bool passed = true;
-    std::string d;
-    if (depends != "") {
-      std::list<std::string> dependencies;
-      split(dependencies, depends, ' ');
-      while (!dependencies.empty()) {
-        component::selector dependency = dependencies.front();
-        
-        /* se if family is here */
-        component::base * requiredcom = components[dependency.family];
-        if (requiredcom == 0) { 
-          passed = false;
-          d = dependency;
-          break;
-        }
-        
-        /* check if dependency has a type. if not, passed. if yes, check */
-        if (dependency.type != "") {
-          if (requiredcom->type() != dependency.type) {
-            passed = false;
-            d = dependency;
-            break;
-          }
-        }
-        dependencies.pop_front();
-      }
-    }
-    
-    if (passed == false) {
+    std::string d = unmet(newc);
+    if (d != "") {
       std::string s;
       s = s + "Component " + newc->family() + "/" + newc->type() + " have unmet dependencies: " + d;
       throw (evildepends(s));
     }
     
     /* ok... dependency check has passed! */
-    component::base * oldc = deattach(newc->family());
+    plug(newc);
+  }
+  
+  std::string object::unmet(component::base * newc) {
+    component::factory::requirement parsed;
+    if (newc->cfactory == 0) {
+      std::vector<std::string> listed;
+      split(listed, newc->depends(), ' ');
+      for (size_t i = 0; i < listed.size(); i++) {
+        parsed.needs.push_back(component::selector(listed[i]));
+        parsed.families.push_back(families().find(parsed.needs.back().family));
+      }
+    }
+    
+    /* components built by a factory have theirs parsed already, family ids too */
+    const component::factory::requirement & dependencies = (newc->cfactory != 0) ? newc->cfactory->dependencies(newc) : parsed;
+    for (size_t i = 0; i < dependencies.needs.size(); i++) {
+      component::selector dependency = dependencies.needs[i];
+      
+      /* see if the family is here */
+      component::base * requiredcom = component(dependencies.families[i]);
+      
+      /* check if dependency has a type. if not, passed. if yes, check */
+      if (requiredcom == 0 || (dependency.type != "" && requiredcom->type() != dependency.type)) return dependency;
+    }
+    return "";
+  }
+  
+  void object::plug(component::base * newc) {
+    modinfo("object");
+    printed = false;
+    symbol family = newc->family();
+    component::base * oldc = deattach(family);
     if (oldc != 0) {
       trace("Detaching old component", oldc->type());
     }
     
     newc->owner = this;
-    components[newc->family()] = newc;
+    components[family] = newc;
+    attached.push_back(family);
+    int slot = families().add(family);
+    if (slot >= (int)comslots.size()) comslots.resize(families().size(), 0);
+    comslots[slot] = newc;
     
     trace("Calling setup on", newc->type());
     newc->setup(sig);
     engine::add(newc);
   }
   
-  component::base * object::deattach(component::family family) {
-    component::base * oldc = components[family];
+  component::base * object::deattach(const symbol & family) {
+    componentcontainer::iterator it = components.find(family);
+    if (it == components.end()) return 0;
+    component::base * oldc = it->second;
+    printed = false;
+    components.erase(it);
+    comslots[families().find(family)] = 0;
+    std::vector<symbol>::iterator at = std::find(attached.begin(), attached.end(), family);
+    if (at != attached.end()) attached.erase(at);
     if (oldc == 0) return 0;
-    components.erase(family);
     engine::remove(oldc);
     return oldc;
   }
 
-  parameterbase::value object::get(const parameterbase::id & pid) {
-    return parameters[pid];
+  parameterbase::value object::get(const symbol & pid) {
+    int slot = shape->find(pid);
+    return (slot >= 0 && slot < (int)slots.size()) ? slots[slot] : 0;
   }
   
-  void object::set(const parameterbase::id & pid, parameterbase::value v) {
-    parameters[pid] = v;
+  void object::set(const symbol & pid, parameterbase::value v) {
+    int slot = shape->add(pid);
+    if (slot >= (int)slots.size()) slots.resize(shape->size(), 0);
+    slots[slot] = v;
     if (v != 0) {
       v->owner = this;
-      v->pid = pid;
+      v->pid = pid.name();
     }
   }
   
-  component::base * object::component(gear2d::component::family f) {
-    return components[f];
+  component::base * object::component(const symbol & f) {
+    return component(families().find(f));
+  }
+  
+  int object::family(const symbol & f) {
+    return families().add(f);
+  }
+  
+  layout & object::families() {
+    static layout ids;
+    return ids;
   }
   
   void object::copy(object::id other) {
     if (other == 0) return;
-    for (parameterbase::table::iterator it = parameters.begin(); it != parameters.end(); it++) {
-      parameterbase::id pid = it->first;
-      parameterbase::value pval = it->second;
+    
+    /* rows of the same storage: every column at once */
+    bool rows = (store != 0 && store == other->store);
+    if (rows) store->copy(other->row, row);
+    
+    for (size_t i = 0; i < slots.size(); i++) {
+      parameterbase::value pval = slots[i];
+      if (pval == 0) continue;
       
-      parameterbase::value otherval = other->get(pid);
-      pval->set(otherval);
+      /* same type, same layout: no need to look it up */
+      parameterbase::value otherval = (other->shape == shape) ? other->get(i) : other->get(shape->name(i));
+      if (otherval == 0) continue;
+      if (!pval->take(otherval, rows && pval->column && otherval->column)) pval->set(otherval);
     }
   }
   
   void object::destroy() {
+    if (destroyed) return;
     destroyed = true;
     engine::destroy(this);
-    ofactory->loadedobjs[sig["name"]].remove(this);
   }
   
   /* -- factory methods */
@@ -141,6 +187,66 @@ namespace gear2d {
 
   }
   
+  object::factory::~factory() {
+    for (map<object::type, pool>::iterator p = pools.begin(); p != pools.end(); p++) drain(p->second);
+    
+    for (map<object::type, layout *>::iterator l = layouts.begin(); l != layouts.end(); l++) delete l->second;
+    for (map<object::type, archetype *>::iterator a = archetypes.begin(); a != archetypes.end(); a++) delete a->second;
+    for (map<object::type, std::vector<symbol> *>::iterator b = buffers.begin(); b != buffers.end(); b++) delete b->second;
+    for (map<object::type, blueprint *>::iterator b = blueprints.begin(); b != blueprints.end(); b++) delete b->second;
+    
+    for (size_t i = 0; i < oldlayouts.size(); i++) delete oldlayouts[i];
+    for (size_t i = 0; i < oldarchetypes.size(); i++) delete oldarchetypes[i];
+    for (size_t i = 0; i < oldbuffers.size(); i++) delete oldbuffers[i];
+    for (size_t i = 0; i < oldblueprints.size(); i++) delete oldblueprints[i];
+  }
+  
+  void object::factory::drain(pool & p) {
+    /* pooled components are out of the engine already, delete them here */
+    for (std::list<object::id>::iterator o = p.idle.begin(); o != p.idle.end(); o++) {
+      componentcontainer & coms = (*o)->components;
+      for (componentcontainer::iterator c = coms.begin(); c != coms.end(); c++) component::base::dispose(c->second);
+      coms.clear();
+      (*o)->ofactory = 0;
+      delete *o;
+    }
+    p.idle.clear();
+    
+    for (size_t i = 0; i < p.pristine.size(); i++) delete p.pristine[i];
+    p.pristine.clear();
+  }
+  
+  void object::factory::forget(object::type objtype) {
+    /* pooled objects were built out of the old one, and are not in use */
+    map<object::type, pool>::iterator p = pools.find(objtype);
+    if (p != pools.end()) {
+      drain(p->second);
+      pools.erase(p);
+    }
+    
+    /* living objects keep pointing to the rest, keep it until we go */
+    map<object::type, layout *>::iterator l = layouts.find(objtype);
+    if (l != layouts.end()) {
+      oldlayouts.push_back(l->second);
+      layouts.erase(l);
+    }
+    map<object::type, archetype *>::iterator a = archetypes.find(objtype);
+    if (a != archetypes.end()) {
+      if (a->second != 0) oldarchetypes.push_back(a->second);
+      archetypes.erase(a);
+    }
+    map<object::type, std::vector<symbol> *>::iterator b = buffers.find(objtype);
+    if (b != buffers.end()) {
+      oldbuffers.push_back(b->second);
+      buffers.erase(b);
+    }
+    map<object::type, blueprint *>::iterator bp = blueprints.find(objtype);
+    if (bp != blueprints.end()) {
+      if (bp->second != 0) oldblueprints.push_back(bp->second);
+      blueprints.erase(bp);
+    }
+  }
+  
   void object::factory::load(object::type objtype, bool reload) {
     modinfo("object-factory");
     if (signatures.find(objtype) != signatures.end() && !reload) {
@@ -148,6 +254,8 @@ namespace gear2d {
       return;
     }
     
+    if (signatures.find(objtype) != signatures.end()) forget(objtype);
+    
     /* open the file */
     string filename = objpath + objtype + ".yaml";
     trace("Loading", objtype, "from", filename);
@@ -183,11 +291,16 @@ namespace gear2d {
   }
   
   object::id object::factory::locate(object::type objtype) {
-    if (loadedobjs[objtype].size() == 0) return 0;
-    else return loadedobjs[objtype].front();
+    /* objects marked for destruction are only dropped when deleted */
+    std::list<object::id> & objs = loadedobjs[objtype];
+    for (std::list<object::id>::iterator i = objs.begin(); i != objs.end(); i++) {
+      if (!(*i)->destroyed) return *i;
+    }
+    return 0;
   }
   
   void object::factory::set(object::type objtype, object::signature sig) {
+    forget(objtype);
     signatures[objtype] = sig;
     return;
   }
@@ -197,48 +310,47 @@ namespace gear2d {
     trace("Object:", o->name(), "Depends:", depends);
     std::set<std::string> comlist;
     split(comlist, depends, ' ');
-    while(comlist.begin() != comlist.end()) {
-      component::selector s = *(comlist.begin());
-      
-      /* maybe the object already has these loaded */
-      component::base * samecom = o->components[s.family];
-      if (samecom != 0) {
-        if ((s.type == "")) {
-          comlist.erase(comlist.begin());
-          continue;
-        }
-        else if ((samecom->type() == s.type)) {
-          comlist.erase(comlist.begin());
-          continue;
-        }
-      }
-      
-      /* samecom not found, continue normal attach proccess */
-      component::base * c = cfactory.build(s);
-      if (c == 0) {
-        cfactory.load(s);
-        c = cfactory.build(s);
-      }
-      
-      if (c == 0) continue;
-      
-      /* first try to attach the component.
-       * if something went wrong, try to load
-       * its dependencies. if still going wrong, give up
-       * and let it fail */
-      try {
-        o->attach(c);
-      } catch (evildepends & e) {
-        /* build dependencies... */
-        trace(e.what());
-        innerbuild(o, c->depends());
-        /* if that build did'nt fixed, fuck it. */
-        o->attach(c);
-      }
-      
-      comlist.erase(comlist.begin());
-     }
-     trace("Finished", o->name(), depends);
+    std::vector<component::family> resolving;
+    for (std::set<std::string>::iterator i = comlist.begin(); i != comlist.end(); i++) {
+      resolve(o, component::selector(*i), resolving);
+    }
+    trace("Finished", o->name(), depends);
+  }
+  
+  bool object::factory::resolve(object * o, component::selector s, std::vector<component::family> & resolving) {
+    modinfo("object-factory");
+    
+    /* maybe the object already has these loaded */
+    component::base * samecom = o->component(s.family);
+    if (samecom != 0 && (s.type == "" || samecom->type() == s.type)) return true;
+    
+    if (std::find(resolving.begin(), resolving.end(), s.family) != resolving.end()) {
+      trace.e("Component", (std::string)s, "depends on itself, giving up on it");
+      return false;
+    }
+    
+    /* samecom not found, continue normal attach proccess */
+    component::base * c = cfactory.build(s);
+    if (c == 0) {
+      cfactory.load(s);
+      c = cfactory.build(s);
+    }
+    if (c == 0) return false;
+    
+    /* dependencies first, so every component finds its own at setup */
+    resolving.push_back(s.family);
+    const std::vector<component::selector> & needs = cfactory.dependencies(c).needs;
+    for (size_t i = 0; i < needs.size(); i++) resolve(o, needs[i], resolving);
+    resolving.pop_back();
+    
+    std::string missing = o->unmet(c);
+    if (missing != "") {
+      trace.e("Component", (std::string)s, "have unmet dependencies:", missing, "and will not be attached");
+      component::base::dispose(c);
+      return false;
+    }
+    o->plug(c);
+    return true;
   }
   
   object::id object::factory::build(gear2d::object::type objtype) {
@@ -252,21 +364,184 @@ namespace gear2d {
     /* now get the signature of this type */
     object::signature & signature = signatures[objtype];
     
-    /* instantiate the object */
-    object * obj = new object(signature);
+    /* reuse a destroyed one if there is */
+    pool & p = pools[objtype];
+    if (p.limit < 0) p.limit = eval<int>(signature["pool"], 0);
+    if (!p.idle.empty()) return revive(objtype, p);
+    
+    /* instantiate the object, sharing the parameter layout of its type */
+    layout *& shape = layouts[objtype];
+    if (shape == 0) shape = new layout;
+    object * obj = new object(signature, shape, columns(objtype), buffering(objtype));
     obj->ofactory = this;
+    blueprint *& print = blueprints[objtype];
+    if (print == 0) print = new blueprint;
+    obj->print = print;
     
+    if (print->ready()) {
+      /* built before: attach what was attached then, in the same order */
+      for (size_t i = 0; i < print->size(); i++) {
+        component::base * c = cfactory.build(print->part(i));
+        if (c != 0) obj->plug(c);
+      }
+    } else {
+      /* now get the attach string */
+      std::string attachstring = signature["attach"];
+      
+      /* if nothing to attach, return the object */
+      if (attachstring == "") return obj;
+      
+      
+      /* recursive build method that takes care of dependency loading */
+      innerbuild(obj, attachstring);
+      
+      /* next objects of this type follow what this one went through */
+      bool complete = true;
+      for (size_t i = 0; i < obj->attached.size(); i++) {
+        component::base * c = obj->component(obj->attached[i]);
+        blueprint::builder b = cfactory.find(component::selector(c->family(), c->type()));
+        if (b == 0) complete = false;
+        print->add(b);
+      }
+      print->finish(complete);
+    }
+    obj->printed = print->ready() && print->size() == obj->attached.size();
+    loadedobjs[objtype].push_back(obj);
     
-    /* now get the attach string */
-    std::string attachstring = signature["attach"];
+    /* the first one tells what a reused object gets back to */
+    if (p.limit > 0 && p.pristine.empty()) {
+      p.pristine.resize(obj->slots.size(), 0);
+      for (size_t i = 0; i < obj->slots.size(); i++) {
+        if (obj->slots[i] != 0) p.pristine[i] = obj->slots[i]->clone();
+      }
+    }
+    return obj;
+  }
+  
+  object::id object::factory::clone(object::id source) {
+    if (source == 0) return 0;
+    object::type objtype = source->name();
     
-    /* if nothing to attach, return the object */
-    if (attachstring == "") return obj;
+    pool & p = pools[objtype];
+    if (p.limit < 0) p.limit = eval<int>(source->sig["pool"], 0);
+    object * obj = 0;
+    if (!p.idle.empty()) obj = revive(objtype, p);
+    else {
+      /* the source met every dependency in this order already */
+      obj = new object(source->sig, source->shape, source->store, source->buffered);
+      obj->ofactory = this;
+      obj->print = source->print;
+      blueprint * print = source->print;
+      if (source->printed) {
+        for (size_t i = 0; i < print->size(); i++) {
+          component::base * c = cfactory.build(print->part(i));
+          if (c != 0) obj->plug(c);
+        }
+        obj->printed = (print->size() == obj->attached.size());
+      } else {
+        for (size_t i = 0; i < source->attached.size(); i++) {
+          component::base * model = source->component(source->attached[i]);
+          component::base * c = cfactory.build(component::selector(model->family(), model->type()));
+          if (c != 0) obj->plug(c);
+        }
+      }
+      loadedobjs[objtype].push_back(obj);
+    }
     
+    obj->copy(source);
+    return obj;
+  }
+  
+  archetype * object::factory::columns(object::type objtype) {
+    map<object::type, archetype *>::iterator it = archetypes.find(objtype);
+    if (it != archetypes.end()) return it->second;
     
-    /* recursive build method that takes care of dependency loading */
-    innerbuild(obj, attachstring);
-    loadedobjs[objtype].push_back(obj);
+    map<object::type, object::signature>::iterator sig = signatures.find(objtype);
+    if (sig == signatures.end()) return 0;
+    std::string & ids = sig->second["columns"];
+    archetype * store = ids.empty() ? 0 : new archetype(ids);
+    archetypes[objtype] = store;
+    return store;
+  }
+  
+  const std::vector<symbol> * object::factory::buffering(object::type objtype) {
+    map<object::type, std::vector<symbol> *>::iterator it = buffers.find(objtype);
+    if (it == buffers.end()) {
+      map<object::type, object::signature>::iterator sig = signatures.find(objtype);
+      if (sig == signatures.end()) return 0;
+      it = buffers.insert(std::make_pair(objtype, new std::vector<symbol>())).first;
+      split(*(it->second), sig->second["buffered"], ' ');
+    }
+    return it->second->empty() ? 0 : it->second;
+  }
+  
+  bool object::factory::recycle(object::id o) {
+    map<object::type, pool>::iterator pit = pools.find(o->name());
+    if (pit == pools.end()) return false;
+    pool & p = pit->second;
+    if (p.limit <= 0 || p.idle.size() >= (size_t)p.limit) return false;
+    
+    std::list<object::id> & live = loadedobjs[o->name()];
+    std::list<object::id>::iterator it = std::find(live.begin(), live.end(), o);
+    if (it == live.end()) return false;
+    
+    /* the engine is about to dispose of components queued for removal */
+    for (componentcontainer::iterator i = o->components.begin(); i != o->components.end(); i++) {
+      if (i->second->removing) return false;
+    }
+    
+    for (componentcontainer::iterator i = o->components.begin(); i != o->components.end(); i++) {
+      i->second->destroyed();
+      
+      /* no timers, no notifications, no waking up while pooled */
+      engine::retire(i->second);
+      i->second->pooled = true;
+    }
+    if (o->store != 0) o->store->pool(o->row, true);
+    
+    /* move the list node itself, so that reusing allocates nothing */
+    p.idle.splice(p.idle.end(), live, it);
+    return true;
+  }
+  
+  object::id object::factory::revive(object::type objtype, pool & p) {
+    object * obj = p.idle.front();
+    loadedobjs[objtype].splice(loadedobjs[objtype].end(), p.idle, p.idle.begin());
+    obj->destroyed = false;
+    if (obj->store != 0) obj->store->pool(obj->row, false);
+    
+    /* values back to how they were built, without bothering any listener */
+    for (size_t i = 0; i < obj->slots.size() && i < p.pristine.size(); i++) {
+      if (obj->slots[i] != 0 && p.pristine[i] != 0) obj->slots[i]->set(p.pristine[i]);
+    }
+    
+    /* components that can't be reset are built anew */
+    bool missing = false;
+    for (componentcontainer::iterator i = obj->components.begin(); i != obj->components.end(); ) {
+      component::base * c = i->second;
+      c->pooled = false;
+      if (c->reset(obj->sig)) {
+        i++;
+        continue;
+      }
+      
+      /* it unhooks itself, here and in other objects, as it goes */
+      obj->attached.erase(std::find(obj->attached.begin(), obj->attached.end(), i->first));
+      obj->comslots[families().find(i->first)] = 0;
+      component::base::dispose(c);
+      i = obj->components.erase(i);
+      obj->printed = false;
+      missing = true;
+    }
+    
+    for (size_t i = 0; i < obj->slots.size(); i++) {
+      if (obj->slots[i] != 0) obj->slots[i]->isolate();
+    }
+    
+    for (componentcontainer::iterator i = obj->components.begin(); i != obj->components.end(); i++) {
+      engine::add(i->second);
+    }
+    if (missing) innerbuild(obj, obj->sig["attach"]);
     return obj;
   }
   
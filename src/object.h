@@ -9,6 +9,10 @@ using std::list;
 
 #include "definitions.h"
 #include "parameter.h"
+#include "symbol.h"
+#include "layout.h"
+#include "archetype.h"
+#include "blueprint.h"
 
 /**
  * @file object.h
@@ -19,7 +23,7 @@ using std::list;
  * (thats ok, but avoid doing so). */
 
 namespace gear2d {
-  namespace component { class base; class factory; typedef std::string type; typedef std::string family; }
+  namespace component { class base; class factory; struct selector; typedef std::string type; typedef std::string family; }
   
   /**
    * @brief An exception to sinalize that this component dependencies are broken.
@@ -116,11 +120,79 @@ namespace gear2d {
              * create a new object with the registered components */
             object::id build(object::type objtype);
             
+            /**
+             * @brief Keep a destroyed object to be built again.
+             * @param o Object marked for destruction
+             * @return true if the object went to the pool of its type,
+             * false if it should be deleted
+             * 
+             * Objects whose signature has @p pool: set to more than 0 are
+             * kept, up to that many per type, instead of deleted. Their
+             * components leave the engine and the next build() of that
+             * type reuses them. See component::base::reset(). */
+            bool recycle(object::id o);
+            
+            /**
+             * @brief Column storage of an object type.
+             * @param objtype Type of the objects
+             * @return The storage, or null if the type lists no @p columns:
+             * or is not loaded */
+            archetype * columns(object::type objtype);
+            
+            /**
+             * @brief Parameters of an object type that are double-buffered.
+             * @param objtype Type of the objects
+             * @return Their ids, or null if the type lists no @p buffered:
+             * or is not loaded */
+            const std::vector<symbol> * buffering(object::type objtype);
+            
+            /**
+             * @brief Build a copy of an object.
+             * @param source Object to be copied
+             * @return The copy, of the same type as @p source
+             * 
+             * Builds the components @p source has, in the order it got
+             * them, without resolving their dependencies again, and then
+             * copies its parameters slot by slot. Listeners are not told
+             * about the copied values. Pooled objects are reused as in
+             * build(). Much cheaper than build() and copy() when making
+             * many copies of a template object. */
+            object::id clone(object::id source);
+            
+            /** @brief Deletes the pooled objects. */
+            ~factory();
+            
           private:
+            /* destroyed objects of a type kept for reuse */
+            struct pool {
+              pool() : limit(-1) { }
+              
+              /* most objects kept, -1 when not read from the signature yet */
+              int limit;
+              
+              /* objects ready to be built again */
+              std::list<object::id> idle;
+              
+              /* parameters as the first built object had them, by slot */
+              std::vector<parameterbase::value> pristine;
+            };
             
-            /* recursive build method. catches attaching evil, loading
-             * and attaching needed dependencies */
+            /* attaches what depends lists, along with their own
+             * dependencies, dependencies first */
             void innerbuild(object * o, std::string depends);
+            
+            /* attaches a component after what it depends on. resolving holds the
+             * families being resolved up the stack, to catch cycles */
+            bool resolve(object * o, component::selector s, std::vector<component::family> & resolving);
+            
+            /* bring a pooled object back to its freshly built state */
+            object::id revive(object::type objtype, pool & p);
+            
+            /* delete the objects a pool keeps */
+            void drain(pool & p);
+            
+            /* drop what was worked out of the signature of a type, it changed */
+            void forget(object::type objtype);
           
           private:
              /* This is the used component factory */
@@ -131,6 +203,28 @@ namespace gear2d {
              
              map<object::type, std::list<object::id> > loadedobjs;
              
+             /* pools of destroyed objects, per type */
+             map<object::type, pool> pools;
+             
+             /* parameter layouts shared by the objects of a type */
+             map<object::type, layout *> layouts;
+             
+             /* column storage of the types that have it, null for the others */
+             map<object::type, archetype *> archetypes;
+             
+             /* double-buffered parameter ids, per type */
+             map<object::type, std::vector<symbol> *> buffers;
+             
+             /* how objects of a type were built, per type */
+             map<object::type, blueprint *> blueprints;
+             
+             /* what forget() dropped, that objects of the old signature
+              * still point to */
+             std::vector<layout *> oldlayouts;
+             std::vector<archetype *> oldarchetypes;
+             std::vector<std::vector<symbol> *> oldbuffers;
+             std::vector<blueprint *> oldblueprints;
+             
              friend class object;
         };
 
@@ -141,10 +235,17 @@ namespace gear2d {
        * This is set whenever the object is built using
        * a factory. */
       object::factory * ofactory;
+      
+      /**
+       * @brief Blueprint of the object type.
+       * 
+       * Set when the object is built using a factory, null otherwise. */
+      gear2d::blueprint * print;
+      
       map< parameterbase::id, parameterbase::value >::const_iterator it;
     
     private:
-      object(object::signature & sig);
+      object(object::signature & sig, layout * shape, archetype * store, const std::vector<symbol> * buffered);
 
     public:
       ~object();
@@ -178,7 +279,7 @@ namespace gear2d {
       void attach(component::base * c) throw (evildepends);
       
       /** @brief Deattach a component, returning it.
-       ** @param type Type of component to be deattached
+       ** @param family Family of the component to be deattached
        ** @return The now deattached component
        
        ** Deattach a component from the object and return it.
@@ -187,16 +288,25 @@ namespace gear2d {
        ** @warning When a component is deattached, the object
        ** gives the sole responsibility of the component to
        ** the user of deattach(). That means that YOU ARE
-       ** RESPONSIBLE FOR DELETING IT. Or you can attach it
+       ** RESPONSIBLE FOR DELETING IT, with
+       ** component::base::dispose(). Or you can attach it
        ** elsewhere. */
-      component::base * deattach(component::type type);
+      component::base * deattach(const symbol & family);
       
       /**
        * @brief Access a named parameter.
        * @param pid Parameter id inside the object
        * @return a @a parameterbase::value reference
        * Use this to access a parameter inside the component */
-      parameterbase::value get(const parameterbase::id & pid);
+      parameterbase::value get(const symbol & pid);
+      
+      /**
+       * @brief Access a parameter by its slot in the layout of this object type.
+       * @param slot Slot of the parameter
+       * @return The parameter, or null if this object has none there */
+      parameterbase::value get(int slot) {
+        return (slot >= 0 && slot < (int)slots.size()) ? slots[slot] : 0;
+      }
       
       /**
        * @brief Set a named parameter for the given value.
@@ -208,11 +318,34 @@ namespace gear2d {
        * If thats not what you mean, just call set() with v->clone().
        * If thats really what you meant, remember to set v->dodestroy to false
        * or you may have multiple delete's or missing references and thats an very ugly crash. Really. */
-      void set(const parameterbase::id & pid, parameterbase::value v);
+      void set(const symbol & pid, parameterbase::value v);
+      
+      /**
+       * @brief Create a parameter and set it.
+       * @param pid Parameter id inside the object
+       * @return The new parameter
+       * 
+       * Its value is kept in the column storage of the object type
+       * when the type has a column for @p pid, and in its own
+       * allocation otherwise. It is double-buffered when the type
+       * lists @p pid as @p buffered:. */
+      template<typename datatype>
+      parameter<datatype> * make(const symbol & pid) {
+        datatype * raw = (store != 0) ? store->at<datatype>(pid, row) : 0;
+        parameter<datatype> * p = (raw != 0) ? new parameter<datatype>(raw) : new parameter<datatype>;
+        p->column = (raw != 0);
+        if (buffered != 0 && std::find(buffered->begin(), buffered->end(), pid) != buffered->end()) p->buffer();
+        set(pid, p);
+        return p;
+      }
       
       /**
        * @brief Copy the parameters from other to this.
-       * @param other Object to be copied from */
+       * @param other Object to be copied from
+       * 
+       * Listeners are not told. Between objects of a type, columns are
+       * copied a row at a time and numbers as plain bytes; only the other
+       * values go through parameterbase::set(). */
       void copy(object::id other);
       
       /**
@@ -220,28 +353,78 @@ namespace gear2d {
        * @param f Family of the component
        * @return A pointer to the component or NULL if it does not exists
        */
-      gear2d::component::base * component(gear2d::component::family f);
+      gear2d::component::base * component(const symbol & f);
+      
+      /**
+       * @brief Access a component by the id of its family.
+       * @param family Id given by family()
+       * @return A pointer to the component or NULL if it does not exists
+       * 
+       * A single indexed read. Keep the id of a family you reach often
+       * instead of looking it up by name every time. */
+      gear2d::component::base * component(int family) {
+        return (family >= 0 && family < (int)comslots.size()) ? comslots[family] : 0;
+      }
+      
+      /**
+       * @brief Dense id of a family.
+       * @param f Family
+       * @return Its id, the same for the whole run
+       * 
+       * Families get ids from 0 up as components of them are registered
+       * or attached. */
+      static int family(const symbol & f);
       
       /**
        * @brief Marks this object to be deleted.
        * @details The object will be deleted in the next frame. */
       void destroy();
       
+    private:
+      /* set up and start an attached component, its dependencies already met */
+      void plug(component::base * c);
+      
+      /* first dependency of c missing in this object, empty if none is */
+      std::string unmet(component::base * c);
+      
     private:
       /* container of its components */
-      typedef map<component::family, component::base *> componentcontainer;
+      typedef map<symbol, component::base *> componentcontainer;
       componentcontainer components;
       
-      /* parameters for this game object */
-      parameterbase::table parameters;
+      /* families of its components in the order they were attached */
+      std::vector<symbol> attached;
+      
+      /* its components by family id, null where it has none */
+      std::vector<component::base *> comslots;
+      
+      /* family ids, shared by every object */
+      static layout & families();
+      
+      /* where each parameter is in slots, shared with objects of the same type */
+      layout * shape;
+      
+      /* parameters for this game object, null where it has none */
+      std::vector<parameterbase::value> slots;
+      
+      /* column storage of its type and its row there, null and -1 without */
+      archetype * store;
+      int row;
+      
+      /* ids of its double-buffered parameters, null when none */
+      const std::vector<symbol> * buffered;
       
       /* marks its deletion */
       bool destroyed;
       
+      /* its components are the ones print lists, in that order */
+      bool printed;
+      
       /* own signature */
       object::signature sig;
       
       friend class gear2d::object::factory;
+      friend class gear2d::parameterbase;
   };
 }
 #endif
@@ -0,0 +1,76 @@
+#include "pacer.h"
+
+#include <chrono>
+#include <thread>
+
+namespace gear2d {
+  /* bounds for the spin margin, in nanoseconds */
+  static const long long minmargin = 200000;
+  static const long long maxmargin = 4000000;
+
+  pacer::pacer(int framerate)
+  : framerate(0)
+  , period(0)
+  , deadline(0)
+  , margin(1000000)
+  , misses(0) {
+    rate(framerate);
+  }
+
+  void pacer::rate(int framerate) {
+    if (framerate < 0) framerate = 0;
+    if (framerate == this->framerate) return;
+    this->framerate = framerate;
+    period = (framerate > 0) ? 1000000000LL / framerate : 0;
+    deadline = 0;
+  }
+
+  int pacer::rate() const {
+    return framerate;
+  }
+
+  unsigned long pacer::missed() const {
+    return misses;
+  }
+
+  long long pacer::now() {
+    using namespace std::chrono;
+    return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+  }
+
+  timediff pacer::wait() {
+    long long start = now();
+    if (period == 0) return 0;
+
+    /* first frame: just start the grid */
+    if (deadline == 0) {
+      deadline = start + period;
+      return 0;
+    }
+
+    /* too late already, start over from here */
+    if (start >= deadline) {
+      misses++;
+      deadline = start + period;
+      return 0;
+    }
+
+    /* sleep most of the way. whatever we oversleep tells how much
+     * earlier we should wake up next time */
+    long long sleep = deadline - start - margin;
+    if (sleep > 0) {
+      std::this_thread::sleep_for(std::chrono::nanoseconds(sleep));
+      long long over = now() - (start + sleep);
+      long long wanted = over + over / 2;
+      margin = (margin * 7 + wanted) / 8;
+      if (margin < minmargin) margin = minmargin;
+      if (margin > maxmargin) margin = maxmargin;
+    }
+
+    /* and spin the rest, letting others run meanwhile */
+    while (now() < deadline) std::this_thread::yield();
+
+    deadline += period;
+    return (now() - start) / 1e9;
+  }
+}
@@ -0,0 +1,64 @@
+#ifndef gear2d_pacer_h
+#define gear2d_pacer_h
+
+#include "definitions.h"
+
+/**
+ * @file pacer.h
+ * @brief Frame pacing for the engine main loop.
+ *
+ * The pacer holds frames to a target rate using a monotonic clock
+ * with nanosecond resolution. It sleeps for most of the wait and
+ * yield-spins only for the last stretch, whose length adapts to how
+ * late the system wakes us up. */
+
+namespace gear2d {
+  /**
+   * @brief Holds the main loop to a target frame rate.
+   *
+   * Deadlines are kept on a fixed grid (one period after the other), so
+   * small wake-up errors do not accumulate. A frame that ends after its
+   * deadline is counted as missed and the grid restarts from it. */
+  class g2dapi pacer {
+    public:
+      /**
+       * @brief Builds a pacer.
+       * @param framerate Target frames per second, 0 for no pacing */
+      pacer(int framerate = 90);
+
+      /**
+       * @brief Change the target frame rate.
+       * @param framerate Target frames per second, 0 for no pacing */
+      void rate(int framerate);
+
+      /** @brief Target frames per second, 0 when not pacing */
+      int rate() const;
+
+      /**
+       * @brief Wait for the next frame deadline.
+       * @return Time waited, in seconds */
+      timediff wait();
+
+      /** @brief Number of frames that ended after their deadline */
+      unsigned long missed() const;
+
+      /** @brief Monotonic clock, in nanoseconds from an arbitrary point */
+      static long long now();
+
+    private:
+      int framerate;
+
+      /* nanoseconds between deadlines */
+      long long period;
+
+      /* next deadline, 0 when there is none yet */
+      long long deadline;
+
+      /* how long before the deadline we stop sleeping and spin */
+      long long margin;
+
+      unsigned long misses;
+  };
+}
+
+#endif
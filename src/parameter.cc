@@ -1,58 +1,240 @@
 #include "parameter.h"
 #include "component.h"
+#include "engine.h"
+
+#include <vector>
+#include <mutex>
 #define CALLBACK(object,ptrToMember)  ((object).*(ptrToMember))
 
 
 
 namespace gear2d {
-  class parameterbase::callback {
-    public:
-      callback(component::base * com, component::call h)
-      : com(com)
-      , fp(h) { }
-      
-      void operator()(std::string pid, component::base * lastwrite, gear2d::object * owner) {
-        if (com == 0) {
-          throw evil("callback with null component");
-        }
-        if (fp == 0) {
-          com->handle(pid, lastwrite, owner);
-        } else {
-          CALLBACK(*com, fp)(pid, lastwrite, owner);
-        }
-      }
-      
-    private:
-      component::base * com;
-      component::call fp;
-      
-      friend class parameterbase;
-  };
+  namespace {
+    /* parameters written while deferring, from every thread */
+    std::atomic<bool> deferring(false);
+    std::vector<parameterbase *> pending;
+    std::mutex pendinglock;
+    
+    /* parameters written inside the transactions of this thread */
+    thread_local int depth = 0;
+    thread_local std::vector<parameterbase *> batch;
+    
+    /* rounds of writes made by handlers that deliver() follows */
+    const int rounds = 16;
+    
+    /* double-buffered parameters written since the last commit */
+    std::vector<parameterbase *> written;
+    std::mutex writtenlock;
+    
+    /* lists taken out of the ones above and being gone through by this
+     * thread, innermost last. handlers may destroy what is still ahead */
+    thread_local std::vector<std::vector<parameterbase *> *> inflight;
+    
+    struct flying {
+      flying(std::vector<parameterbase *> & list) { inflight.push_back(&list); }
+      ~flying() { inflight.pop_back(); }
+    };
+  }
   
   void parameterbase::hook(component::base * c) {
     hook(c, 0);
   }
   
   void parameterbase::hook(component::base * c, component::call handlefp) {
-    hooked.insert(new callback(c, handlefp));
+    callback h;
+    h.com = c;
+    h.fp = handlefp;
+    hooked.push_back(h);
+    remember(c);
   }
   
-void parameterbase::unhook(component::base* c)
-{
-  for (std::set<callback*>::iterator i = hooked.begin(); i != hooked.end(); i++)
-    if ((*i)->com == c)
-      hooked.erase(i);
-}
-
+  void parameterbase::unhook(component::base * c) {
+    for (size_t i = hooked.size(); i > 0; i--) {
+      if (hooked[i - 1].com == c) hooked.erase(i - 1);
+    }
+    forget(c);
+  }
+  
+  void parameterbase::isolate() {
+    for (size_t i = hooked.size(); i > 0; i--) {
+      component::base * stranger = hooked[i - 1].com;
+      bool own = false;
+      for (object::componentcontainer::iterator c = owner->components.begin(); c != owner->components.end(); c++) {
+        if (c->second == stranger) own = true;
+      }
+      if (own) continue;
+      hooked.erase(i - 1);
+      forget(stranger);
+    }
+  }
+  
+  void parameterbase::remember(component::base * c) {
+    smallvector<parameterbase *, 2> & hooking = c->hooking;
+    for (size_t i = 0; i < hooking.size(); i++) if (hooking[i] == this) return;
+    hooking.push_back(this);
+  }
+  
+  void parameterbase::forget(component::base * c) {
+    smallvector<parameterbase *, 2> & hooking = c->hooking;
+    for (size_t i = hooking.size(); i > 0; i--) if (hooking[i - 1] == this) hooking.erase(i - 1);
+  }
   
   void parameterbase::pull() {
-    for (std::set<callback *>::iterator i = hooked.begin(); i != hooked.end(); i++) {
-      if (*i == NULL) continue;
-      callback & c = *(*i);
-      c(pid, lastwrite, owner);
+    /* handlers may hook or unhook, so go by index and look at the size again */
+    for (size_t i = 0; i < hooked.size(); i++) {
+      callback h = hooked[i];
+      if (h.com == 0) throw evil("callback with null component");
+      
+      /* listeners whose object waits in a pool hear nothing until it is reused */
+      if (h.com->pooled) continue;
+      
+      /* writing a hooked parameter wakes its listener */
+      if (h.com->sleeping()) h.com->wake();
+      if (h.fp == 0) h.com->handle(pid, lastwrite, owner);
+      else CALLBACK(*h.com, h.fp)(pid, lastwrite, owner);
+    }
+  }
+  
+  void parameterbase::touch() {
+    /* only counts, nothing else is published through them */
+    version.fetch_add(1, std::memory_order_relaxed);
+    stamp.store(engine::frame(), std::memory_order_relaxed);
+  }
+  
+  void parameterbase::notify() {
+    touch();
+    if (depth > 0) {
+      if (!queued.exchange(true)) batch.push_back(this);
+    } else if (deferring.load(std::memory_order_relaxed)) {
+      if (queued.exchange(true)) return;
+      std::lock_guard<std::mutex> guard(pendinglock);
+      pending.push_back(this);
+    } else {
+      pull();
     }
   }
   
+  void parameterbase::defer(bool enable) {
+    deferring.store(enable, std::memory_order_relaxed);
+  }
+  
+  size_t parameterbase::deliver() {
+    size_t delivered = 0;
+    std::vector<parameterbase *> round;
+    for (int i = 0; i < rounds; i++) {
+      {
+        std::lock_guard<std::mutex> guard(pendinglock);
+        if (pending.empty()) break;
+        round.swap(pending);
+      }
+      delivered += flush(round);
+      round.clear();
+    }
+    return delivered;
+  }
+  
+  size_t parameterbase::flush(std::vector<parameterbase *> & written) {
+    modwarn("parameter");
+    flying guard(written);
+    size_t pulled = 0;
+    for (size_t i = 0; i < written.size(); i++) {
+      parameterbase * p = written[i];
+      if (p == 0) continue;
+      p->queued.store(false);
+      p->locked = true;
+      
+      /* there is no writer up the stack to catch this for */
+      try {
+        p->pull();
+      } catch (evil & e) {
+        trace(e.what());
+      }
+      
+      /* its own listener may have destroyed it */
+      if (written[i] != 0) p->locked = false;
+      pulled++;
+    }
+    return pulled;
+  }
+  
+  void parameterbase::stage() {
+    if (staged.exchange(true)) return;
+    std::lock_guard<std::mutex> guard(writtenlock);
+    written.push_back(this);
+  }
+  
+  size_t parameterbase::commit() {
+    std::vector<parameterbase *> flipping;
+    {
+      std::lock_guard<std::mutex> guard(writtenlock);
+      flipping.swap(written);
+    }
+    flying guard(flipping);
+    
+    /* every value first, so listeners see the whole pass committed */
+    for (size_t i = 0; i < flipping.size(); i++) {
+      parameterbase * p = flipping[i];
+      if (p == 0) continue;
+      p->staged.store(false);
+      p->flip();
+    }
+    
+    /* writes made now are committed by the next call */
+    size_t committed = 0;
+    for (size_t i = 0; i < flipping.size(); i++) {
+      if (flipping[i] == 0) continue;
+      flipping[i]->notify();
+      committed++;
+    }
+    return committed;
+  }
+  
+  parameterbase::~parameterbase() {
+    /* listeners outlive us, they must not keep us in their list */
+    for (size_t i = 0; i < hooked.size(); i++) forget(hooked[i].com);
+    
+    /* do not leave a dangling pointer behind for deliver() or commit() */
+    if (queued.load()) {
+      for (size_t i = 0; i < batch.size(); i++) if (batch[i] == this) batch[i] = 0;
+      std::lock_guard<std::mutex> guard(pendinglock);
+      for (size_t i = 0; i < pending.size(); i++) if (pending[i] == this) pending[i] = 0;
+    }
+    if (staged.load()) {
+      std::lock_guard<std::mutex> guard(writtenlock);
+      for (size_t i = 0; i < written.size(); i++) if (written[i] == this) written[i] = 0;
+    }
+    
+    /* taken out of pending or written, whatever the flags say */
+    for (size_t l = 0; l < inflight.size(); l++) {
+      std::vector<parameterbase *> & list = *inflight[l];
+      for (size_t i = 0; i < list.size(); i++) if (list[i] == this) list[i] = 0;
+    }
+  }
+  
+  void parameterbase::discard() {
+    {
+      std::lock_guard<std::mutex> guard(pendinglock);
+      for (size_t i = 0; i < pending.size(); i++) if (pending[i] != 0) pending[i]->queued.store(false);
+      pending.clear();
+    }
+    std::lock_guard<std::mutex> guard(writtenlock);
+    for (size_t i = 0; i < written.size(); i++) if (written[i] != 0) written[i]->staged.store(false);
+    written.clear();
+  }
+  
+  transaction::transaction() {
+    depth++;
+  }
+  
+  transaction::~transaction() {
+    if (--depth > 0) return;
+    
+    /* handlers may open transactions of their own, keep them apart */
+    std::vector<parameterbase *> written;
+    written.swap(batch);
+    parameterbase::flush(written);
+  }
+  
   badlink::badlink() : evil("Someone is trying to access a link that is initialized!") { }
   
 }
\ No newline at end of file
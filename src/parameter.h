@@ -3,10 +3,15 @@
 
 #include "definitions.h"
 #include "logtrace.h"
+#include "smallvector.h"
 #include <string>
 #include <map>
 #include <set>
 #include <list>
+#include <vector>
+#include <atomic>
+#include <cstring>
+#include <type_traits>
 
 #include <iostream>
 
@@ -86,9 +91,22 @@ namespace gear2d {
        * another. */
       bool dodestroy;
       
+      /**
+       * @brief Times this parameter was written.
+       * 
+       * Only goes up, so comparing it with a copy kept from before tells
+       * whether someone wrote in between, without hooking. Worker threads
+       * may bump it while others read it, hence atomic. */
+      std::atomic<unsigned long> version;
+      
+      /**
+       * @brief Engine frame of the last write, -1 before the first one.
+       * @see engine::frame() */
+      std::atomic<long> stamp;
+      
     public:
       /** @brief Initializes an empty parameterbase */
-      parameterbase() { dodestroy = true; lastwrite = 0; owner = 0; pid = ""; }
+      parameterbase() : version(0), stamp(-1), queued(false), locked(false), staged(false), bytes(0), backbytes(0), size(0), column(false) { dodestroy = true; lastwrite = 0; owner = 0; pid = ""; }
       
       /** @brief Clone this parameter and its value */
       virtual parameterbase::value clone() const = 0;
@@ -121,6 +139,10 @@ namespace gear2d {
        * @param c Component to be unhooked */
       void unhook(component::base * c);
       
+      /**
+       * @brief Unhook every listener that is not a component of the owner. */
+      void isolate();
+      
       /**
        * @brief Compare two parameters.
        * @param other Other parameter to compare.
@@ -136,13 +158,136 @@ namespace gear2d {
        * @brief Pull all the hooked-in components */
       void pull();
       
+      /**
+       * @brief Count a write in version and stamp.
+       * 
+       * notify() calls it, so every set() does, through one or the other. */
+      void touch();
       
-      virtual ~parameterbase() { };
+      /**
+       * @brief Tell the hooked-in components about a write.
+       * 
+       * Pulls right away, unless notifications are deferred or a
+       * transaction is open in this thread. Then the parameter is
+       * queued, once no matter how many writes it takes, and pulled
+       * when they end. */
+      void notify();
+      
+      /**
+       * @brief Defer notifications of every thread until deliver().
+       * @param enable Whether to defer
+       * 
+       * The engine does this while it updates components, when the
+       * scene asks for deferred notifications. */
+      static void defer(bool enable);
+      
+      /**
+       * @brief Pull every parameter queued while deferring.
+       * @return How many parameters were pulled
+       * 
+       * Each queued parameter is pulled once, with the last writer as
+       * lastwrite. Writes made by the handlers are delivered too, for
+       * a few rounds, and the rest waits for the next call. */
+      static size_t deliver();
+      
+      /**
+       * @brief Publish what was written to double-buffered parameters.
+       * @return How many parameters changed
+       * 
+       * Each written parameter takes its back value as the one everybody
+       * reads, and then notifies its listeners. The engine calls this at
+       * the end of each pass.
+       * @see parameter::buffer() */
+      static size_t commit();
+      
+      /**
+       * @brief Drop every write still waiting for deliver() or commit().
+       * 
+       * The engine does this when it starts over, so that nothing of the
+       * previous scene is delivered in the next one. */
+      static void discard();
+      
+      virtual ~parameterbase();
       
     protected:
-      class callback;
-      std::set<callback *> hooked;
-    
+      /* a listener and its handler, null to call handle() */
+      struct callback {
+        component::base * com;
+        component::call fp;
+      };
+      
+      /* listeners in the order they hooked. most parameters have one or two */
+      smallvector<callback, 2> hooked;
+      
+      /* add us to, or drop us from, the parameters a listener hooked */
+      void remember(component::base * c);
+      void forget(component::base * c);
+      
+      /* waiting for deliver() or the end of a transaction */
+      std::atomic<bool> queued;
+      
+      /* listeners are being pulled, writing now is evil */
+      bool locked;
+      
+      /* pull each queued parameter of a list */
+      static size_t flush(std::vector<parameterbase *> & written);
+      
+      /* waiting for commit() */
+      std::atomic<bool> staged;
+      
+      /* wait for commit(), once no matter how many writes */
+      void stage();
+      
+      /* make the back value the one that is read */
+      virtual void flip() { }
+      
+      /* the value, and the back value when double-buffered, when copying
+       * their bytes copies them. null for other types */
+      void * bytes;
+      void * backbytes;
+      size_t size;
+      
+      /* the value lives in the column storage of the object type */
+      bool column;
+      
+      /* copy the value of other as set() would, without the virtual call.
+       * when copied, the value is already in place. false if either is
+       * not plain bytes, and then nothing was done */
+      bool take(const parameterbase * other, bool copied) {
+        if (bytes == 0 || other->bytes == 0 || size != other->size) return false;
+        if (!copied) std::memcpy(bytes, other->bytes, size);
+        if (backbytes != 0) std::memcpy(backbytes, bytes, size);
+        touch();
+        return true;
+      }
+      
+      friend class transaction;
+      friend class object;
+  };
+  
+  /**
+   * @brief Groups writes to parameters.
+   * 
+   * While a transaction lives, writes made by its thread notify
+   * no one. When the outermost transaction ends, each parameter
+   * written meanwhile is pulled once, so listeners see every value
+   * already in place and are called once per parameter.
+   * 
+   * @code
+   * {
+   *   transaction t;
+   *   write("x", 10.0f);
+   *   write("y", 20.0f);
+   * } // listeners of x and y are called here
+   * @endcode */
+  class g2dapi transaction {
+    public:
+      transaction();
+      ~transaction();
+      
+    private:
+      transaction(const transaction &);
+      transaction & operator=(const transaction &);
   };
   
   /*
@@ -253,6 +398,36 @@ namespace gear2d {
           throw(gear2d::badlink());
         return ((basetype) *target);
       }
+      
+      /**
+       * @brief Times the parameter was written.
+       * @throw badlink When the link is unlinked
+       * 
+       * Keep the last version you looked at to find out if it changed since. */
+      unsigned long version() const throw (gear2d::badlink) {
+        if (target == 0) 
+          throw(gear2d::badlink());
+        return target->version.load(std::memory_order_relaxed);
+      }
+      
+      /**
+       * @brief Whether the parameter was written in a frame or after it.
+       * @param frame Engine frame, as given by engine::frame(), or before
+       * it to ask for any write at all
+       * @throw badlink When the link is unlinked
+       * 
+       * Lets components that only care once per frame poll instead of
+       * hooking. Writes made before a component is updated and writes made
+       * after it both count for the same frame:
+       * @code
+       * if (position.changed_since(engine::frame() - 1)) recalculate();
+       * @endcode */
+      bool changed_since(long frame) const throw (gear2d::badlink) {
+        if (target == 0) 
+          throw(gear2d::badlink());
+        long stamp = target->stamp.load(std::memory_order_relaxed);
+        return stamp >= 0 && stamp >= frame;
+      }
   };
   
   /**
@@ -270,7 +445,7 @@ namespace gear2d {
   class parameter : public parameterbase {
     private:
       datatype * raw;
-      bool locked;
+      datatype * back;
       bool mine;
       
     public:
@@ -281,17 +456,17 @@ namespace gear2d {
        * @warning Don't keed with me and delete raw before destroying this.
        * I will crash and will laugh at you, because its your fault. You've been
        * warned. */
-      parameter(datatype * raw) : raw(raw), locked(false), mine(false) { }
+      parameter(datatype * raw) : raw(raw), back(0), mine(false) { plain(); }
       
       /**
        * @brief Creates a new parameter */
-      parameter() : raw(new datatype), locked(false), mine(true) { }
+      parameter() : raw(new datatype), back(0), mine(true) { plain(); }
       
       /**
        * @brief Creates a new parameter using a raw value as base.
        * 
-       * Copies the raw data into a new space */
-      parameter(datatype raw) : raw(new datatype(raw)), locked(false), mine(false) { }
+       * Copies the raw data into a new space, deleted along with it */
+      parameter(datatype raw) : raw(new datatype(raw)), back(0), mine(true) { plain(); }
       
       /**
        * @brief Sets internal data of parameter.
@@ -303,14 +478,28 @@ namespace gear2d {
        * @code try { } catch (evil & e) { } @endcode
        * 
        * This usually happens when your component try to set() inside handle()
+       * 
+       * Writes to a double-buffered parameter go to its back value and
+       * are seen when the engine commits them. Its very first write, the
+       * one giving it its initial value, is seen right away.
        */
       virtual void set(const datatype & raw) throw(evil) {
+        if (back != 0) {
+          /* nothing to keep reading yet: seed both values */
+          if (version.load(std::memory_order_relaxed) == 0) {
+            *(this->raw) = raw;
+            touch();
+          }
+          *back = raw;
+          stage();
+          return;
+        }
         if (locked == true) {
           throw(evil(pid + ": someone tried to write while locked."));
         }
         *(this->raw) = raw;
         locked = true;
-        pull();
+        notify();
         locked = false;
       }
       
@@ -319,12 +508,35 @@ namespace gear2d {
        * @param other parameter to be copied from
        * 
        * This will call cast the parameter and set from its raw value.
+       * Double-buffered parameters take it right away, in both values.
        *
        * @warning There's no type checking or whatsoever.
        */
       virtual void set(const parameterbase * other) throw (evil) {
         const parameter<datatype> * p = static_cast<const parameter<datatype> *>(other);
         *raw = *(p->raw);
+        if (back != 0) *back = *raw;
+        touch();
+      }
+      
+      /**
+       * @brief Double-buffer this parameter.
+       * 
+       * From now on writes go to a back value, and reads keep seeing the
+       * value from before until commit() makes the back one current. During
+       * an update every component reads what the previous pass left, no
+       * matter which thread updates it or when, and no one sees a value
+       * half-written. If more than one component writes it in a pass, the
+       * last write is the one committed.
+       * 
+       * The back value itself is not guarded: components writing it in
+       * the same pass must be updated by the same thread, which rules out
+       * writers from independent or parallel families sharing it.
+       * 
+       * Object types list their double-buffered parameters in @p buffered:. */
+      void buffer() {
+        if (back == 0) back = new datatype(*raw);
+        if (bytes != 0) backbytes = back;
       }
       /**
        * @brief Clone a parameter.
@@ -336,7 +548,9 @@ namespace gear2d {
         parameter<datatype> * cloned = new parameter<datatype>(*raw); // call constructor with reference to copy.
         cloned->pid = this->pid;
         cloned->hooked = this->hooked;
+        for (size_t i = 0; i < cloned->hooked.size(); i++) cloned->remember(cloned->hooked[i].com);
         cloned->dodestroy = true; // cloned parameters must always be destroyed.
+        if (back != 0) cloned->buffer();
         return cloned;
       }
       
@@ -362,7 +576,21 @@ namespace gear2d {
       
       virtual ~parameter() { 
         if (mine) delete raw;
+        delete back;
       };
+      
+    protected:
+      virtual void flip() {
+        std::swap(*raw, *back);
+      }
+      
+    private:
+      /* values that copy as bytes can be copied without set() */
+      void plain() {
+        if (!std::is_trivially_copyable<datatype>::value) return;
+        bytes = raw;
+        size = sizeof(datatype);
+      }
   };
 }
 
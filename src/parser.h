@@ -0,0 +1,161 @@
+#ifndef gear2d_parser_h
+#define gear2d_parser_h
+
+#include <string>
+#include <sstream>
+#include <limits>
+#include <type_traits>
+
+/**
+ * @file parser.h
+ * @brief Parsers behind eval().
+ *
+ * Signature values are parsed for every parameter of every object
+ * built, so numbers are parsed by hand, without a stringstream, without
+ * allocating and without regard to the global locale. Any other type
+ * goes through a stringstream, unless it gets a parser of its own. */
+
+namespace gear2d {
+  /**
+   * @brief Parses a type out of a string.
+   *
+   * Specialize this to teach eval() a new type. Like the stream
+   * extraction it replaces, a parser may skip leading whitespace and
+   * should stop at the first character that does not belong to the
+   * value, ignoring the rest.
+   *
+   * @code
+   * template<> struct parser<vec2> {
+   *   static bool parse(const std::string & raw, vec2 & value) {
+   *     size_t comma = raw.find(',');
+   *     return comma != std::string::npos
+   *       && parser<float>::parse(raw.substr(0, comma), value.x)
+   *       && parser<float>::parse(raw.substr(comma + 1), value.y);
+   *   }
+   * };
+   * @endcode */
+  template<typename datatype, typename enable = void>
+  struct parser {
+    /**
+     * @brief Parses raw into value.
+     * @return Whether raw held a value */
+    static bool parse(const std::string & raw, datatype & value) {
+      std::stringstream sstr;
+      sstr << raw;
+      sstr >> value;
+      return !sstr.fail();
+    }
+  };
+
+  namespace parsing {
+    /* whitespace as the "C" locale knows it */
+    inline const char * skip(const char * c) {
+      while (*c == ' ' || *c == '\t' || *c == '\n' || *c == '\r' || *c == '\v' || *c == '\f') c++;
+      return c;
+    }
+
+    /* exact powers of ten a double holds */
+    inline double power(int e) {
+      static const double powers[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+      };
+      return powers[e];
+    }
+  }
+
+  /**
+   * @brief Parser of integers, in decimal.
+   *
+   * Values that do not fit the type are not parsed. Negative values
+   * wrap around for unsigned types, as with streams. */
+  template<typename datatype>
+  struct parser<datatype, typename std::enable_if<std::is_integral<datatype>::value
+    && !std::is_same<datatype, bool>::value
+    && !std::is_same<datatype, char>::value
+    && !std::is_same<datatype, signed char>::value
+    && !std::is_same<datatype, unsigned char>::value>::type> {
+    static bool parse(const std::string & raw, datatype & value) {
+      const char * c = parsing::skip(raw.c_str());
+      bool negative = (*c == '-');
+      if (*c == '-' || *c == '+') c++;
+      if (*c < '0' || *c > '9') return false;
+
+      /* gather the magnitude, which may be one past the largest positive value */
+      typedef typename std::make_unsigned<datatype>::type magnitude;
+      magnitude limit = (magnitude)std::numeric_limits<datatype>::max();
+      if (negative && std::is_signed<datatype>::value) limit++;
+      magnitude m = 0;
+      for (; *c >= '0' && *c <= '9'; c++) {
+        magnitude digit = *c - '0';
+        if (m > (limit - digit) / 10) return false;
+        m = m * 10 + digit;
+      }
+      value = negative ? (datatype)(0 - m) : (datatype)m;
+      return true;
+    }
+  };
+
+  /**
+   * @brief Parser of floating point numbers, in decimal with an optional exponent.
+   *
+   * Numbers of up to 15 significant digits and exponents up to 22 are
+   * parsed exactly by hand; anything else is handed to a stringstream
+   * in the "C" locale. */
+  template<typename datatype>
+  struct parser<datatype, typename std::enable_if<std::is_floating_point<datatype>::value>::type> {
+    static bool parse(const std::string & raw, datatype & value) {
+      const char * c = parsing::skip(raw.c_str());
+      const char * begin = c;
+      bool negative = (*c == '-');
+      if (*c == '-' || *c == '+') c++;
+
+      /* mantissa, as an integer, and how many of its digits went after the point */
+      unsigned long long m = 0;
+      int digits = 0, scale = 0;
+      bool any = false;
+      for (; *c >= '0' && *c <= '9'; c++, any = true) {
+        if (m == 0 && *c == '0') continue;
+        if (digits < 19) m = m * 10 + (*c - '0'), digits++;
+        else scale++;
+      }
+      if (*c == '.') {
+        for (c++; *c >= '0' && *c <= '9'; c++, any = true) {
+          if (m == 0 && *c == '0') { scale--; continue; }
+          if (digits < 19) m = m * 10 + (*c - '0'), digits++, scale--;
+        }
+      }
+      if (!any) return false;
+
+      /* an exponent without digits spoils the number */
+      if (*c == 'e' || *c == 'E') {
+        const char * e = c + 1;
+        bool down = (*e == '-');
+        if (*e == '-' || *e == '+') e++;
+        if (*e < '0' || *e > '9') return false;
+        int exponent = 0;
+        for (; *e >= '0' && *e <= '9'; e++) if (exponent < 10000) exponent = exponent * 10 + (*e - '0');
+        scale += down ? -exponent : exponent;
+      }
+
+      /* mantissa and power both exact in a double: one rounding, as good as it gets */
+      if (digits <= 15 && scale >= -22 && scale <= 22) {
+        double v = (double)m;
+        v = (scale < 0) ? v / parsing::power(-scale) : v * parsing::power(scale);
+        value = (datatype)(negative ? -v : v);
+        return true;
+      }
+      if (m == 0) {
+        value = negative ? -(datatype)0 : (datatype)0;
+        return true;
+      }
+
+      std::istringstream sstr(begin);
+      sstr.imbue(std::locale::classic());
+      sstr >> value;
+      return !sstr.fail();
+    }
+  };
+}
+
+#endif
@@ -0,0 +1,114 @@
+#include "profiler.h"
+
+#include <fstream>
+#include <algorithm>
+#include "SDL.h"
+
+namespace gear2d {
+  profiler::section::section(const std::string & name, size_t window)
+  : name(name)
+  , window(window, 0.0f)
+  , next(0)
+  , count(0)
+  , pending(0)
+  , touched(false) {
+  }
+
+  void profiler::section::add(double seconds) {
+    std::lock_guard<std::mutex> guard(lock);
+    pending += seconds;
+    touched = true;
+  }
+
+  profiler::profiler(size_t window)
+  : window(window > 0 ? window : 1) {
+  }
+
+  profiler::~profiler() {
+    for (std::map<std::string, section *>::iterator i = sections.begin(); i != sections.end(); i++) {
+      delete i->second;
+    }
+  }
+
+  profiler::section * profiler::get(const std::string & name) {
+    std::lock_guard<std::mutex> guard(lock);
+    section *& s = sections[name];
+    if (s == 0) s = new section(name, window);
+    return s;
+  }
+
+  void profiler::frame() {
+    std::lock_guard<std::mutex> guard(lock);
+    for (std::map<std::string, section *>::iterator i = sections.begin(); i != sections.end(); i++) {
+      section & s = *(i->second);
+      std::lock_guard<std::mutex> sguard(s.lock);
+      if (!s.touched) continue;
+      s.window[s.next] = s.pending;
+      s.next = (s.next + 1) % window;
+      if (s.count < window) s.count++;
+      s.pending = 0;
+      s.touched = false;
+    }
+  }
+
+  profiler::stat profiler::compute(section & s) {
+    std::lock_guard<std::mutex> guard(s.lock);
+    profiler::stat st;
+    st.name = s.name;
+    st.min = st.avg = st.p99 = st.last = 0;
+    st.samples = s.count;
+    if (s.count == 0) return st;
+
+    std::vector<float> sorted(s.window.begin(), s.window.begin() + s.count);
+    std::sort(sorted.begin(), sorted.end());
+    double sum = 0;
+    for (size_t i = 0; i < sorted.size(); i++) sum += sorted[i];
+
+    /* nearest-rank percentile */
+    size_t rank = (sorted.size() * 99 + 99) / 100;
+    st.min = sorted.front();
+    st.avg = sum / sorted.size();
+    st.p99 = sorted[rank - 1];
+    st.last = s.window[(s.next + window - 1) % window];
+    return st;
+  }
+
+  std::vector<profiler::stat> profiler::stats() {
+    std::lock_guard<std::mutex> guard(lock);
+    std::vector<profiler::stat> all;
+    for (std::map<std::string, section *>::iterator i = sections.begin(); i != sections.end(); i++) {
+      all.push_back(compute(*(i->second)));
+    }
+    return all;
+  }
+
+  profiler::stat profiler::stats(const std::string & name) {
+    std::lock_guard<std::mutex> guard(lock);
+    std::map<std::string, section *>::iterator i = sections.find(name);
+    if (i == sections.end()) {
+      profiler::stat st;
+      st.name = name;
+      st.min = st.avg = st.p99 = st.last = 0;
+      st.samples = 0;
+      return st;
+    }
+    return compute(*(i->second));
+  }
+
+  bool profiler::dump(const std::string & filename) {
+    std::ofstream out(filename.c_str(), std::ofstream::out | std::ofstream::trunc);
+    if (!out) return false;
+    std::vector<profiler::stat> all = stats();
+    out << "section,min,avg,p99,last,samples" << std::endl;
+    for (size_t i = 0; i < all.size(); i++) {
+      profiler::stat & st = all[i];
+      out << st.name << "," << st.min << "," << st.avg << "," << st.p99 << "," << st.last << "," << st.samples << std::endl;
+    }
+    return true;
+  }
+
+  double profiler::now() {
+    static double frequency = (double)SDL_GetPerformanceFrequency();
+    return SDL_GetPerformanceCounter() / frequency;
+  }
+}
@@ -0,0 +1,124 @@
+#ifndef gear2d_profiler_h
+#define gear2d_profiler_h
+
+#include "definitions.h"
+
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+
+/**
+ * @file profiler.h
+ * @brief Frame profiler used by the engine.
+ *
+ * The profiler keeps, for every timed section of a frame, the time
+ * spent in it over the last frames and derives rolling statistics
+ * from them. */
+
+namespace gear2d {
+  /**
+   * @brief Rolling frame-time statistics per named section.
+   *
+   * Time is added to a section as many times as needed during a frame
+   * and becomes one sample when the frame is closed. Only the last
+   * samples (the window) are kept. */
+  class g2dapi profiler {
+    public:
+      /** @brief Statistics of a section, in seconds. */
+      struct stat {
+        /** @brief Name of the section */
+        std::string name;
+
+        /** @brief Smallest sample in the window */
+        double min;
+
+        /** @brief Average of the window */
+        double avg;
+
+        /** @brief 99th percentile of the window */
+        double p99;
+
+        /** @brief Sample of the last closed frame */
+        double last;
+
+        /** @brief Number of samples in the window */
+        size_t samples;
+      };
+
+      /**
+       * @brief Something timed in a frame.
+       *
+       * Sections are owned by the profiler and keep their address
+       * for its whole life, so they can be cached. */
+      class section {
+        public:
+          /**
+           * @brief Account time spent in this section in the current frame.
+           * @param seconds Time spent
+           *
+           * Safe to call from any thread. */
+          void add(double seconds);
+
+        private:
+          section(const std::string & name, size_t window);
+
+        private:
+          std::string name;
+          std::vector<float> window;
+          size_t next;
+          size_t count;
+          double pending;
+          bool touched;
+          std::mutex lock;
+
+          friend class profiler;
+      };
+
+    public:
+      /**
+       * @brief Creates a profiler.
+       * @param window Number of frames the statistics are computed over */
+      profiler(size_t window = 128);
+      ~profiler();
+
+      /**
+       * @brief Get a section, creating it if needed.
+       * @param name Name of the section */
+      section * get(const std::string & name);
+
+      /**
+       * @brief Close the current frame.
+       *
+       * Every section that had time added becomes a new sample. */
+      void frame();
+
+      /** @brief Statistics of every section, ordered by name. */
+      std::vector<profiler::stat> stats();
+
+      /**
+       * @brief Statistics of a single section.
+       * @param name Name of the section
+       * @return Its statistics, zeroed if the section does not exist */
+      profiler::stat stats(const std::string & name);
+
+      /**
+       * @brief Write the statistics of every section as CSV.
+       * @param filename File to write to
+       * @return false if the file could not be written */
+      bool dump(const std::string & filename);
+
+      /** @brief High-resolution time, in seconds, from an arbitrary point. */
+      static double now();
+
+    private:
+      profiler::stat compute(section & s);
+
+    private:
+      size_t window;
+      std::map<std::string, section *> sections;
+      std::mutex lock;
+  };
+}
+
+#endif
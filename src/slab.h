@@ -0,0 +1,83 @@
+#ifndef gear2d_slab_h
+#define gear2d_slab_h
+
+#include <cstddef>
+#include <vector>
+#include <mutex>
+#include <new>
+#include <type_traits>
+
+/**
+ * @file slab.h
+ * @brief Per-type allocator that keeps items of a type together.
+ *
+ * Components of a family are updated one after the other. When each
+ * one comes from its own trip to the heap, they end up scattered and
+ * every update starts with a cache miss. Taking them from slabs of
+ * their type keeps them next to each other. */
+
+namespace gear2d {
+  /**
+   * @brief Slabs of memory for items of one type.
+   *
+   * Memory is taken in chunks of chunksize items and handed out one
+   * item at a time, in order. Given back items are reused first, the
+   * last given back the first reused. Chunks are kept for the life of
+   * the program, so items may outlive whoever uses the slab.
+   *
+   * It hands out memory only: construct with placement new and destroy
+   * by hand before giving it back. */
+  template<typename item>
+  class slab {
+    public:
+      /** @brief Items per chunk. */
+      static const size_t chunksize = 64;
+
+    public:
+      /** @brief The slab of this type. */
+      static slab & shared() {
+        static slab * s = new slab;
+        return *s;
+      }
+
+      /** @brief Memory for one item. */
+      void * take() {
+        std::lock_guard<std::mutex> guard(lock);
+        if (unused != 0) {
+          cell * c = unused;
+          unused = c->next;
+          return c;
+        }
+        if (chunks.empty() || used == chunksize) {
+          chunks.push_back(new cell[chunksize]);
+          used = 0;
+        }
+        return &chunks.back()[used++];
+      }
+
+      /** @brief Gives back memory of take(), its item already destroyed. */
+      void give(void * p) {
+        if (p == 0) return;
+        std::lock_guard<std::mutex> guard(lock);
+        cell * c = static_cast<cell *>(p);
+        c->next = unused;
+        unused = c;
+      }
+
+    private:
+      slab() : used(0), unused(0) { }
+
+      /* room for an item, or a link to the next unused one */
+      union cell {
+        typename std::aligned_storage<sizeof(item), std::alignment_of<item>::value>::type storage;
+        cell * next;
+      };
+
+      std::vector<cell *> chunks;
+      size_t used;
+      cell * unused;
+      std::mutex lock;
+  };
+}
+
+#endif
@@ -0,0 +1,89 @@
+#ifndef gear2d_smallvector_h
+#define gear2d_smallvector_h
+
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+
+/**
+ * @file smallvector.h
+ * @brief Vector that keeps its first few items inline.
+ *
+ * Most lists in the engine hold one or two items. Keeping those inside
+ * the owner saves an allocation per list and a pointer chase per read. */
+
+namespace gear2d {
+  /**
+   * @brief Vector of plain items with room for capacity of them inline.
+   *
+   * Past capacity items move to the heap, doubling as they grow, and stay
+   * there until clear(). Items are copied around as bytes, so only
+   * trivially copyable types fit. Copies own their items. */
+  template<typename item, size_t capacity>
+  class smallvector {
+    static_assert(std::is_trivially_copyable<item>::value, "smallvector only holds trivially copyable items");
+
+    public:
+      smallvector() : items(local), count(0), room(capacity) { }
+
+      smallvector(const smallvector & other) : items(local), count(0), room(capacity) {
+        *this = other;
+      }
+
+      smallvector & operator=(const smallvector & other) {
+        if (&other == this) return *this;
+        clear();
+        reserve(other.count);
+        std::memcpy(items, other.items, other.count * sizeof(item));
+        count = other.count;
+        return *this;
+      }
+
+      ~smallvector() {
+        if (items != local) delete [] items;
+      }
+
+      size_t size() const { return count; }
+      bool empty() const { return count == 0; }
+
+      item & operator[](size_t i) { return items[i]; }
+      const item & operator[](size_t i) const { return items[i]; }
+
+      void push_back(const item & i) {
+        if (count == room) reserve(room * 2);
+        items[count++] = i;
+      }
+
+      /** @brief Removes an item, keeping the others in order. */
+      void erase(size_t i) {
+        std::memmove(items + i, items + i + 1, (count - i - 1) * sizeof(item));
+        count--;
+      }
+
+      /** @brief Removes every item, giving back heap storage. */
+      void clear() {
+        if (items != local) delete [] items;
+        items = local;
+        count = 0;
+        room = capacity;
+      }
+
+    private:
+      void reserve(size_t wanted) {
+        if (wanted <= room) return;
+        item * bigger = new item[wanted];
+        std::memcpy(bigger, items, count * sizeof(item));
+        if (items != local) delete [] items;
+        items = bigger;
+        room = wanted;
+      }
+
+    private:
+      item local[capacity];
+      item * items;
+      size_t count;
+      size_t room;
+  };
+}
+
+#endif
@@ -0,0 +1,144 @@
+#include "symbol.h"
+
+#include <deque>
+#include <vector>
+#include <mutex>
+#include <atomic>
+
+namespace gear2d {
+  namespace {
+    /* strings are interned once and never move, so tables can point to
+     * them. readers go through the current table without a lock; a full
+     * table is copied into one twice as big, entries are only ever set once */
+    struct symboltable {
+      struct table {
+        table(int room, size_t buckets)
+        : room(room)
+        , names(new std::atomic<const std::string *>[room])
+        , mask(buckets - 1)
+        , ids(new std::atomic<int>[buckets]) {
+          for (int i = 0; i < room; i++) names[i].store(0, std::memory_order_relaxed);
+          for (size_t b = 0; b < buckets; b++) ids[b].store(0, std::memory_order_relaxed);
+        }
+
+        ~table() {
+          delete [] names;
+          delete [] ids;
+        }
+
+        /* id to string */
+        int room;
+        std::atomic<const std::string *> * names;
+
+        /* open addressing on the string hash, 0 marks an empty bucket */
+        size_t mask;
+        std::atomic<int> * ids;
+      };
+
+      symboltable()
+      : count(1) {
+        table * t = new table(256, 512);
+        strings.push_back("");
+        t->names[0].store(&strings.back(), std::memory_order_relaxed);
+        current.store(t, std::memory_order_release);
+      }
+
+      ~symboltable() {
+        delete current.load();
+        for (size_t i = 0; i < retired.size(); i++) delete retired[i];
+      }
+
+      /* 0 when absent, and for the empty string */
+      int find(const std::string & name) const {
+        const table * t = current.load(std::memory_order_acquire);
+        for (size_t b = hash(name) & t->mask; ; b = (b + 1) & t->mask) {
+          int id = t->ids[b].load(std::memory_order_acquire);
+          if (id == 0) return 0;
+          if (*(t->names[id].load(std::memory_order_acquire)) == name) return id;
+        }
+      }
+
+      int intern(const std::string & name) {
+        int id = find(name);
+        if (id != 0) return id;
+
+        std::lock_guard<std::mutex> guard(lock);
+        id = find(name);
+        if (id != 0) return id;
+
+        /* keep buckets at most half full */
+        id = count.load(std::memory_order_relaxed);
+        table * t = current.load(std::memory_order_relaxed);
+        if (id >= t->room || (size_t)(id + 1) * 2 > t->mask + 1) {
+          table * bigger = new table(t->room * 2, (t->mask + 1) * 2);
+          for (int i = 0; i < id; i++) {
+            const std::string * s = t->names[i].load(std::memory_order_relaxed);
+            bigger->names[i].store(s, std::memory_order_relaxed);
+            if (i != 0) place(bigger, *s, i);
+          }
+          current.store(bigger, std::memory_order_release);
+          retired.push_back(t);
+          t = bigger;
+        }
+
+        /* the name goes first, whoever finds the id may read it */
+        strings.push_back(name);
+        t->names[id].store(&strings.back(), std::memory_order_release);
+        place(t, name, id);
+        count.store(id + 1, std::memory_order_release);
+        return id;
+      }
+
+      const std::string & name(int id) const {
+        return *(current.load(std::memory_order_acquire)->names[id].load(std::memory_order_acquire));
+      }
+
+      static void place(table * t, const std::string & name, int id) {
+        size_t b = hash(name) & t->mask;
+        while (t->ids[b].load(std::memory_order_relaxed) != 0) b = (b + 1) & t->mask;
+        t->ids[b].store(id, std::memory_order_release);
+      }
+
+      static size_t hash(const std::string & name) {
+        return std::hash<std::string>()(name);
+      }
+
+      std::atomic<table *> current;
+      std::atomic<int> count;
+
+      /* only touched by whoever holds the lock */
+      std::mutex lock;
+      std::deque<std::string> strings;
+
+      /* tables replaced by a bigger one, kept for readers still on them */
+      std::vector<table *> retired;
+    };
+
+    symboltable & symbols() {
+      static symboltable table;
+      return table;
+    }
+  }
+
+  symbol::symbol(const std::string & name)
+  : index(name.empty() ? 0 : symbols().intern(name)) {
+  }
+
+  symbol::symbol(const char * name)
+  : index((name == 0 || *name == 0) ? 0 : symbols().intern(name)) {
+  }
+
+  const std::string & symbol::name() const {
+    return symbols().name(index);
+  }
+
+  symbol symbol::find(const std::string & name) {
+    symbol s;
+    s.index = symbols().find(name);
+    return s;
+  }
+
+  int symbol::count() {
+    return symbols().count.load(std::memory_order_acquire);
+  }
+}
@@ -0,0 +1,74 @@
+#ifndef gear2d_symbol_h
+#define gear2d_symbol_h
+
+#include "definitions.h"
+
+#include <string>
+#include <functional>
+
+/**
+ * @file symbol.h
+ * @brief Interned identifiers.
+ *
+ * Parameter ids and component families are strings in the API, but
+ * the engine keys its tables by symbols: small integers that stand
+ * for a string interned once in a global table. Comparing and hashing
+ * a symbol is comparing and hashing an int. */
+
+namespace gear2d {
+  /**
+   * @brief An interned string.
+   *
+   * Building a symbol from a string looks it up in the global table,
+   * adding it if needed, so keep symbols around instead of strings
+   * when the same id is used over and over. Two symbols are equal
+   * when their strings are. The empty string is symbol 0.
+   *
+   * Symbols can be built and read from any thread. Reading a name and
+   * building a symbol of a string already interned take no lock. */
+  class g2dapi symbol {
+    public:
+      /** @brief The empty symbol. */
+      symbol() : index(0) { }
+
+      /** @brief Intern a string. */
+      symbol(const std::string & name);
+
+      /** @brief Intern a C string. */
+      symbol(const char * name);
+
+      /** @brief Small integer unique to this string, 0 for the empty one. */
+      int id() const { return index; }
+
+      /** @brief The interned string. */
+      const std::string & name() const;
+
+      /** @brief Whether this is the empty symbol. */
+      bool empty() const { return index == 0; }
+
+      bool operator==(const symbol & other) const { return index == other.index; }
+      bool operator!=(const symbol & other) const { return index != other.index; }
+
+      /** @brief Orders by interning, not by name. */
+      bool operator<(const symbol & other) const { return index < other.index; }
+
+      /**
+       * @brief Look a string up without interning it.
+       * @return Its symbol, or the empty one if it was never interned */
+      static symbol find(const std::string & name);
+
+      /** @brief Number of interned strings, the empty one included. */
+      static int count();
+
+    private:
+      int index;
+  };
+}
+
+namespace std {
+  template<> struct hash<gear2d::symbol> {
+    size_t operator()(const gear2d::symbol & s) const { return (size_t)s.id(); }
+  };
+}
+
+#endif
@@ -0,0 +1,130 @@
+#include "threadpool.h"
+
+namespace gear2d {
+  /* pool and queue index of the running worker thread */
+  static thread_local threadpool * workerpool = 0;
+  static thread_local int workerindex = -1;
+
+  threadpool::threadpool(int workers)
+  : queued(0)
+  , next(0)
+  , stopping(false) {
+    if (workers < 0) workers = 0;
+    for (int i = 0; i < workers; i++) queues.push_back(new queue);
+    for (int i = 0; i < workers; i++) threads.push_back(std::thread(&threadpool::work, this, i));
+  }
+
+  threadpool::~threadpool() {
+    {
+      std::lock_guard<std::mutex> guard(sleeplock);
+      stopping = true;
+    }
+    wakeup.notify_all();
+    for (size_t i = 0; i < threads.size(); i++) threads[i].join();
+    for (size_t i = 0; i < queues.size(); i++) delete queues[i];
+  }
+
+  int threadpool::size() const {
+    return threads.size();
+  }
+
+  int threadpool::current() const {
+    return (workerpool == this) ? workerindex : -1;
+  }
+
+  void threadpool::push(batch & b, const task & t) {
+    /* no workers, no queues: just do it */
+    if (queues.empty()) {
+      t();
+      return;
+    }
+
+    int self = current();
+    queue & q = *queues[self >= 0 ? self : (next++ % queues.size())];
+    b.pending++;
+    {
+      std::lock_guard<std::mutex> guard(q.lock);
+      job j = { t, &b };
+      q.jobs.push_back(j);
+    }
+
+    /* lock so a worker about to sleep does not miss it. threads
+     * waiting on a batch are woken too, they can help with it */
+    {
+      std::lock_guard<std::mutex> guard(sleeplock);
+      queued++;
+    }
+    wakeup.notify_one();
+    finished.notify_all();
+  }
+
+  bool threadpool::pop(int self, job & j) {
+    if (queued == 0) return false;
+    size_t n = queues.size();
+
+    /* our own queue first, newest job */
+    if (self >= 0) {
+      queue & q = *queues[self];
+      std::lock_guard<std::mutex> guard(q.lock);
+      if (!q.jobs.empty()) {
+        j = q.jobs.back();
+        q.jobs.pop_back();
+        queued--;
+        return true;
+      }
+    }
+
+    /* then steal the oldest job of someone else */
+    size_t start = (self >= 0) ? self + 1 : 0;
+    for (size_t i = 0; i < n; i++) {
+      queue & q = *queues[(start + i) % n];
+      std::lock_guard<std::mutex> guard(q.lock);
+      if (!q.jobs.empty()) {
+        j = q.jobs.front();
+        q.jobs.pop_front();
+        queued--;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void threadpool::run(job & j) {
+    j.fn();
+    if (j.owner->pending.fetch_sub(1) == 1) {
+      std::lock_guard<std::mutex> guard(sleeplock);
+      finished.notify_all();
+    }
+  }
+
+  void threadpool::work(int self) {
+    workerpool = this;
+    workerindex = self;
+    job j;
+    while (true) {
+      if (pop(self, j)) {
+        run(j);
+        continue;
+      }
+
+      std::unique_lock<std::mutex> guard(sleeplock);
+      while (!stopping && queued == 0) wakeup.wait(guard);
+      if (stopping && queued == 0) return;
+    }
+  }
+
+  void threadpool::wait(batch & b) {
+    int self = current();
+    job j;
+    while (b.pending > 0) {
+      if (pop(self, j)) {
+        run(j);
+        continue;
+      }
+
+      /* nothing to help with: sleep until the batch is done or new work shows up */
+      std::unique_lock<std::mutex> guard(sleeplock);
+      while (b.pending > 0 && queued == 0) finished.wait(guard);
+    }
+  }
+}
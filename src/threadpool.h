@@ -0,0 +1,115 @@
+#ifndef gear2d_threadpool_h
+#define gear2d_threadpool_h
+
+#include "definitions.h"
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+/**
+ * @file threadpool.h
+ * @brief Work-stealing pool of worker threads used by the engine.
+ *
+ * Each worker owns a queue of tasks. Workers take from the back
+ * of their own queue and, when it is empty, steal from the front
+ * of the others. Tasks are grouped in batches so that whoever
+ * pushed them can wait for exactly that work to be finished. */
+
+namespace gear2d {
+  /**
+   * @brief Pool of worker threads with per-worker task queues.
+   *
+   * Threads waiting for a batch help running queued tasks instead
+   * of sleeping, so a task may push and wait for a nested batch
+   * without deadlocking the pool. */
+  class g2dapi threadpool {
+    public:
+      /** @brief Unit of work run by the pool. */
+      typedef std::function<void()> task;
+
+      /**
+       * @brief Group of tasks that can be waited on.
+       *
+       * A batch must outlive the wait() call on it. */
+      class batch {
+        public:
+          batch() : pending(0) { }
+
+        private:
+          std::atomic<int> pending;
+          friend class threadpool;
+      };
+
+    public:
+      /**
+       * @brief Starts a pool.
+       * @param workers Number of worker threads to start, besides the caller's. */
+      threadpool(int workers);
+
+      /** @brief Finishes queued work and joins the workers. */
+      ~threadpool();
+
+      /** @brief Number of worker threads in this pool. */
+      int size() const;
+
+      /**
+       * @brief Queues a task.
+       * @param b Batch the task pertains to
+       * @param t Task to run
+       *
+       * Tasks pushed from a worker go to its own queue, others are
+       * distributed among the workers. */
+      void push(batch & b, const task & t);
+
+      /**
+       * @brief Waits until every task of a batch has run.
+       * @param b Batch to wait for
+       *
+       * The caller runs queued tasks while waiting. */
+      void wait(batch & b);
+
+    private:
+      struct job {
+        task fn;
+        batch * owner;
+      };
+
+      struct queue {
+        std::mutex lock;
+        std::deque<job> jobs;
+      };
+
+    private:
+      /* worker main loop */
+      void work(int self);
+
+      /* take a job from our queue or steal one from another */
+      bool pop(int self, job & j);
+
+      /* run a job and account it in its batch */
+      void run(job & j);
+
+      /* index of the calling thread's queue, -1 if not a worker of ours */
+      int current() const;
+
+    private:
+      std::vector<queue *> queues;
+      std::vector<std::thread> threads;
+
+      /* jobs queued but not taken yet */
+      std::atomic<int> queued;
+      std::atomic<unsigned> next;
+
+      std::mutex sleeplock;
+      std::condition_variable wakeup;
+      std::condition_variable finished;
+      bool stopping;
+  };
+}
+
+#endif
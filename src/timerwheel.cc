@@ -0,0 +1,104 @@
+#include "timerwheel.h"
+
+#include <cmath>
+
+namespace gear2d {
+  timerwheel::timerwheel(timediff resolution, size_t slots)
+  : resolution(resolution > 0 ? resolution : 1.0/256)
+  , clock(0)
+  , remainder(0)
+  , tick(0)
+  , buckets(slots > 0 ? slots : 1, (timer *) 0) {
+  }
+
+  timerwheel::~timerwheel() {
+    /* owners may be long gone, leave their lists alone */
+    for (size_t i = 0; i < buckets.size(); i++) {
+      timer * t = buckets[i];
+      while (t != 0) {
+        timer * next = t->next;
+        delete t;
+        t = next;
+      }
+    }
+  }
+
+  timerwheel::timer * timerwheel::add(timer *& owner, timediff delay, const callback & fire) {
+    timer * t = new timer;
+    t->fire = fire;
+    t->due = clock + (long long)std::floor((remainder + delay) / resolution);
+    if (t->due <= tick) t->due = tick + 1;
+
+    /* append to the bucket, keeping the adding order */
+    timer *& head = buckets[t->due % buckets.size()];
+    if (head == 0) {
+      t->prev = t;
+      t->next = 0;
+      head = t;
+    } else {
+      t->prev = head->prev;
+      t->next = 0;
+      head->prev->next = t;
+      head->prev = t;
+    }
+
+    t->sibling = owner;
+    if (owner != 0) owner->back = &t->sibling;
+    t->back = &owner;
+    owner = t;
+    return t;
+  }
+
+  void timerwheel::unlink(timer * t) {
+    timer *& head = buckets[t->due % buckets.size()];
+    if (t == head) {
+      head = t->next;
+      if (head != 0) head->prev = t->prev;
+    } else {
+      t->prev->next = t->next;
+      if (t->next != 0) t->next->prev = t->prev;
+      else head->prev = t->prev;
+    }
+
+    *(t->back) = t->sibling;
+    if (t->sibling != 0) t->sibling->back = t->back;
+  }
+
+  void timerwheel::cancel(timer * t) {
+    if (t == 0) return;
+    unlink(t);
+    delete t;
+  }
+
+  void timerwheel::clear(timer *& owner) {
+    while (owner != 0) cancel(owner);
+  }
+
+  void timerwheel::advance(timediff dt) {
+    remainder += dt;
+    long long whole = (long long)std::floor(remainder / resolution);
+    clock += whole;
+    remainder -= whole * resolution;
+    while (tick < clock) {
+      tick++;
+
+      /* timers of later turns share the bucket, skip them. a callback may
+       * cancel any other timer, so look from the head after each one */
+      timer *& head = buckets[tick % buckets.size()];
+      for (;;) {
+        timer * t = head;
+        while (t != 0 && t->due > tick) t = t->next;
+        if (t == 0) break;
+        callback fire;
+        fire.swap(t->fire);
+        unlink(t);
+        delete t;
+        fire();
+      }
+    }
+  }
+
+  double timerwheel::now() const {
+    return clock * resolution + remainder;
+  }
+}
@@ -0,0 +1,98 @@
+#ifndef gear2d_timerwheel_h
+#define gear2d_timerwheel_h
+
+#include "definitions.h"
+
+#include <vector>
+#include <functional>
+
+/**
+ * @file timerwheel.h
+ * @brief Timer wheel used by the engine to schedule callbacks.
+ *
+ * Timers are hashed by their due tick into a ring of buckets. Moving
+ * time forward only visits the buckets of the ticks that passed, so
+ * thousands of pending timers cost next to nothing per frame. */
+
+namespace gear2d {
+  /**
+   * @brief Hashed timer wheel.
+   *
+   * Each timer also belongs to a list owned by whoever scheduled it, so
+   * all the timers of an owner can be cancelled at once. Timers due in
+   * the same tick fire in the order they were added. */
+  class g2dapi timerwheel {
+    public:
+      /** @brief What a timer runs when it is due. */
+      typedef std::function<void()> callback;
+
+      /** @brief A pending timer. Owned by the wheel. */
+      class timer {
+        private:
+          callback fire;
+          long long due;
+
+          /* bucket list. the head's prev is the tail */
+          timer * prev;
+          timer * next;
+
+          /* owner list */
+          timer ** back;
+          timer * sibling;
+
+          friend class timerwheel;
+      };
+
+    public:
+      /**
+       * @brief Builds a wheel.
+       * @param resolution Length of a tick, in seconds
+       * @param slots Number of buckets in the ring */
+      timerwheel(timediff resolution = 1.0/256, size_t slots = 512);
+
+      /** @brief Drops every pending timer without firing it. */
+      ~timerwheel();
+
+      /**
+       * @brief Schedules a callback.
+       * @param owner Owner list the timer joins
+       * @param delay Seconds from now, rounded to the next tick at least
+       * @param fire Callback to run
+       * @return The timer, valid until it fires or is cancelled */
+      timer * add(timer *& owner, timediff delay, const callback & fire);
+
+      /** @brief Cancels a single pending timer. */
+      void cancel(timer * t);
+
+      /** @brief Cancels every pending timer of an owner list. */
+      void clear(timer *& owner);
+
+      /**
+       * @brief Moves time forward, firing the timers that got due.
+       * @param dt Seconds passed
+       *
+       * Callbacks may add and cancel timers. Timers they add fire
+       * no sooner than the next tick. */
+      void advance(timediff dt);
+
+      /** @brief Seconds passed since the wheel was built. */
+      double now() const;
+
+    private:
+      void unlink(timer * t);
+
+    private:
+      double resolution;
+
+      /* time passed, in whole ticks plus the seconds of the tick under
+       * way. a float clock would run out of precision in a long session */
+      long long clock;
+      double remainder;
+
+      /* last tick whose timers fired */
+      long long tick;
+      std::vector<timer *> buckets;
+  };
+}
+
+#endif